@@ -0,0 +1,268 @@
+/**
+ * @file adtbench.c
+ * @brief Microbenchmarks for the DArray and HashMap ADTs, run by `make bench`.
+ * @details Measures insert, lookup, iterate and remove throughput for both structures at sizes
+ *          from 10 up to 10^7 elements (in powers of 10). Small sizes are repeated over several
+ *          rounds so that every measurement covers at least MIN_OPERATIONS operations.
+ *
+ *          Inserts start from an empty structure, so they include every resize on the way to the
+ *          final size. Resize behaviour is reported separately as insert_worst, the slowest single
+ *          insert seen while filling the structure, which is the cost of the largest resize.
+ *
+ *          Results are printed as tab-separated values with a header line, one line per structure,
+ *          operation and size, in a fixed order:
+ *
+ *          structure  operation  elements  rounds  ns_per_op
+ *
+ *          Must be built against the objects in obj/, after `make all`.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/ADTs/darray.h"
+#include "../src/ADTs/hashmap.h"
+
+#define MIN_SIZE 10
+#define DEFAULT_MAX_SIZE 10000000
+#define MIN_OPERATIONS 1000000
+#define KEY_SIZE 16
+
+static char *keys;             // Keys of all the elements, KEY_SIZE bytes apart
+static int *order;             // A fixed pseudo-random permutation of the element indices
+static uintptr_t sink;         // Accumulates looked up values so that lookups are not optimised away
+
+/**
+ * @brief Gets the current time in nanoseconds from a monotonic clock.
+ */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief Gets the key of an element.
+ */
+static const char *key_of(int index) {
+    return keys + (size_t) index * KEY_SIZE;
+}
+
+/**
+ * @brief Prepares the keys and lookup order for up to the given number of elements.
+ *
+ * The order is a Fisher-Yates shuffle driven by a fixed linear congruential generator, so it is
+ * the same on every run.
+ */
+static void init_inputs(int max_size) {
+    keys = malloc((size_t) max_size * KEY_SIZE);
+    order = malloc((size_t) max_size * sizeof(int));
+    if (keys == NULL || order == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < max_size; i++) {
+        snprintf(keys + (size_t) i * KEY_SIZE, KEY_SIZE, "key%d", i);
+        order[i] = i;
+    }
+
+    uint64_t state = 0x2545f4914f6cdd1d;
+    for (int i = max_size - 1; i > 0; i--) {
+        state = state * 6364136223846793005 + 1442695040888963407;
+        int j = (state >> 33) % (i + 1);
+        int temp = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+    }
+}
+
+/**
+ * @brief Prints one line of results.
+ */
+static void report(const char *structure, const char *operation, int size, int rounds, uint64_t total_ns, uint64_t operations) {
+    printf("%s\t%s\t%d\t%d\t%.2f\n", structure, operation, size, rounds, (double) total_ns / operations);
+    fflush(stdout);
+}
+
+/**
+ * @brief Callback for darray_for_each that adds each element to the sink.
+ */
+static void darray_visit(int index, void *element, void *state) {
+    sink += (uintptr_t) element;
+}
+
+/**
+ * @brief Callback for hashmap_for_each that adds each value to the sink.
+ */
+static void hashmap_visit(const char *key, void *value, void *state) {
+    sink += (uintptr_t) value;
+}
+
+/**
+ * @brief Benchmarks a DArray of the given size.
+ *
+ * Lookups get elements in a pseudo-random order and removes take elements off the end, the way
+ * the assembler and debugger use their arrays. Removing from the front would move the whole
+ * array each time and measure memmove rather than the structure.
+ */
+static void bench_darray(int size, int rounds) {
+    uint64_t insert_ns = 0, lookup_ns = 0, iterate_ns = 0, remove_ns = 0, start;
+
+    for (int round = 0; round < rounds; round++) {
+        DArray *da = darray_init(NULL);
+
+        start = now_ns();
+        for (int i = 0; i < size; i++) {
+            darray_add(da, (void *) (uintptr_t) (i + 1));
+        }
+        insert_ns += now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < size; i++) {
+            sink += (uintptr_t) darray_get(da, order[i] % size);
+        }
+        lookup_ns += now_ns() - start;
+
+        start = now_ns();
+        darray_for_each(da, darray_visit, NULL);
+        iterate_ns += now_ns() - start;
+
+        start = now_ns();
+        for (int i = size - 1; i >= 0; i--) {
+            sink += (uintptr_t) darray_remove(da, i);
+        }
+        remove_ns += now_ns() - start;
+
+        darray_free(da);
+    }
+
+    // Time every insert of a single fill on its own to find the slowest, which includes the largest resize
+    DArray *da = darray_init(NULL);
+    uint64_t worst_ns = 0;
+    for (int i = 0; i < size; i++) {
+        start = now_ns();
+        darray_add(da, (void *) (uintptr_t) (i + 1));
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed > worst_ns) {
+            worst_ns = elapsed;
+        }
+    }
+    darray_free(da);
+
+    uint64_t operations = (uint64_t) size * rounds;
+    report("darray", "insert", size, rounds, insert_ns, operations);
+    report("darray", "insert_worst", size, 1, worst_ns, 1);
+    report("darray", "lookup", size, rounds, lookup_ns, operations);
+    report("darray", "iterate", size, rounds, iterate_ns, operations);
+    report("darray", "remove", size, rounds, remove_ns, operations);
+}
+
+/**
+ * @brief Benchmarks a HashMap of the given size.
+ *
+ * Lookups and removes use every key in a pseudo-random order, so they are not helped by the
+ * keys having been inserted in order.
+ */
+static void bench_hashmap(int size, int rounds) {
+    uint64_t insert_ns = 0, lookup_ns = 0, iterate_ns = 0, remove_ns = 0, start;
+
+    // The permutation covers all of the largest size, so keep only the indices that fall within this size
+    int *size_order = malloc((size_t) size * sizeof(int));
+    if (size_order == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0, j = 0; j < size; i++) {
+        if (order[i] < size) {
+            size_order[j++] = order[i];
+        }
+    }
+
+    for (int round = 0; round < rounds; round++) {
+        HashMap *hmap = hashmap_init(NULL);
+
+        start = now_ns();
+        for (int i = 0; i < size; i++) {
+            hashmap_set(hmap, key_of(i), (void *) (uintptr_t) (i + 1));
+        }
+        insert_ns += now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < size; i++) {
+            sink += (uintptr_t) hashmap_get(hmap, key_of(size_order[i]));
+        }
+        lookup_ns += now_ns() - start;
+
+        start = now_ns();
+        hashmap_for_each(hmap, hashmap_visit, NULL);
+        iterate_ns += now_ns() - start;
+
+        start = now_ns();
+        for (int i = 0; i < size; i++) {
+            sink += (uintptr_t) hashmap_remove(hmap, key_of(size_order[i]));
+        }
+        remove_ns += now_ns() - start;
+
+        hashmap_free(hmap);
+    }
+
+    // Time every insert of a single fill on its own to find the slowest, which includes the largest resize
+    HashMap *hmap = hashmap_init(NULL);
+    uint64_t worst_ns = 0;
+    for (int i = 0; i < size; i++) {
+        start = now_ns();
+        hashmap_set(hmap, key_of(i), (void *) (uintptr_t) (i + 1));
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed > worst_ns) {
+            worst_ns = elapsed;
+        }
+    }
+    hashmap_free(hmap);
+    free(size_order);
+
+    uint64_t operations = (uint64_t) size * rounds;
+    report("hashmap", "insert", size, rounds, insert_ns, operations);
+    report("hashmap", "insert_worst", size, 1, worst_ns, 1);
+    report("hashmap", "lookup", size, rounds, lookup_ns, operations);
+    report("hashmap", "iterate", size, rounds, iterate_ns, operations);
+    report("hashmap", "remove", size, rounds, remove_ns, operations);
+}
+
+/**
+ * Main function for the ADT microbenchmarks.
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line argument strings, optionally "-m max-size" to stop at a
+ *             smaller power of 10 than 10^7.
+ * @return EXIT_SUCCESS if every benchmark ran, otherwise EXIT_FAILURE.
+ */
+int main(int argc, char **argv) {
+    int max_size = DEFAULT_MAX_SIZE;
+    if (argc == 3 && strcmp(argv[1], "-m") == 0 && atoi(argv[2]) >= MIN_SIZE) {
+        max_size = atoi(argv[2]);
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: bench/bin/adtbench [-m max-size]\n");
+        return EXIT_FAILURE;
+    }
+
+    init_inputs(max_size);
+
+    printf("structure\toperation\telements\trounds\tns_per_op\n");
+
+    for (int size = MIN_SIZE; size <= max_size; size *= 10) {
+        int rounds = size < MIN_OPERATIONS ? MIN_OPERATIONS / size : 1;
+        bench_darray(size, rounds);
+        bench_hashmap(size, rounds);
+        if (size > INT32_MAX / 10) {
+            break;
+        }
+    }
+
+    free(keys);
+    free(order);
+    return EXIT_SUCCESS;
+}
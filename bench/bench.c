@@ -0,0 +1,245 @@
+/**
+ * @file bench.c
+ * @brief Benchmark driver for the assembler and emulator, run by `make bench`.
+ * @details Assembles and emulates every workload in bench/workloads, and assembles a large
+ *          generated source file, timing each run of bin/assemble and bin/emulate as a child
+ *          process. The best wall time and the largest peak RSS over all repetitions are
+ *          reported as tab-separated values with a header line, one line per tool and workload:
+ *
+ *          tool  workload  runs  instructions  wall_seconds  mips  peak_rss_kib
+ *
+ *          For emulate, instructions is the number executed (from `emulate --stats`). For
+ *          assemble, it is the number of instructions assembled. mips is instructions per
+ *          microsecond of wall time for both.
+ *
+ *          Must be run from the root of the repository, after `make all`.
+ */
+
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define ASSEMBLE_PATH "bin/assemble"
+#define EMULATE_PATH "bin/emulate"
+#define WORKLOAD_DIR "bench/workloads"
+#define OUT_DIR "bench/out"
+#define PATH_SIZE 256
+#define STDERR_BUFFER_SIZE 4096
+#define DEFAULT_RUNS 3
+#define INSTR_SIZE 4
+
+// Number of blocks of generated instructions in the large assembler workload
+#define LARGE_SOURCE_BLOCKS 20000
+
+static const char *const workloads[] = {"arith_loop", "memory_stream", "branchy", "led_blink_delay"};
+
+#define NUM_WORKLOADS (sizeof(workloads) / sizeof(workloads[0]))
+
+// Measurements of one run of a child process
+typedef struct {
+    double wall_seconds;
+    long peak_rss_kib;
+    char stderr_output[STDERR_BUFFER_SIZE];
+} RunResult;
+
+/**
+ * @brief Runs a program to completion, measuring its wall time and peak RSS.
+ *
+ * The program's stdout is discarded and its stderr is captured into the result.
+ *
+ * @param argv Null-terminated argument vector, starting with the path of the program.
+ * @param result Pointer to store the measurements (updated by reference).
+ *
+ * @note The function exits the program with a failure status if the child does not exit successfully.
+ */
+static void run(char *const argv[], RunResult *result) {
+    int err_pipe[2];
+    if (pipe(err_pipe) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(err_pipe[1], STDERR_FILENO);
+        close(err_pipe[0]);
+        execv(argv[0], argv);
+        perror(argv[0]);
+        _exit(EXIT_FAILURE);
+    }
+
+    close(err_pipe[1]);
+    size_t length = 0;
+    ssize_t bytes_read;
+    while ((bytes_read = read(err_pipe[0], result->stderr_output + length, STDERR_BUFFER_SIZE - 1 - length)) > 0) {
+        length += bytes_read;
+    }
+    result->stderr_output[length] = '\0';
+    close(err_pipe[0]);
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        fprintf(stderr, "%s failed:\n%s", argv[0], result->stderr_output);
+        exit(EXIT_FAILURE);
+    }
+
+    result->wall_seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    result->peak_rss_kib = usage.ru_maxrss;
+}
+
+/**
+ * @brief Runs a program several times, keeping the best wall time and the largest peak RSS.
+ * @param argv Null-terminated argument vector, starting with the path of the program.
+ * @param runs Number of times to run the program.
+ * @param best Pointer to store the combined measurements (updated by reference).
+ */
+static void run_repeatedly(char *const argv[], int runs, RunResult *best) {
+    RunResult result;
+    long peak_rss_kib = 0;
+    for (int i = 0; i < runs; i++) {
+        run(argv, &result);
+        if (i == 0 || result.wall_seconds < best->wall_seconds) {
+            *best = result;
+        }
+        if (result.peak_rss_kib > peak_rss_kib) {
+            peak_rss_kib = result.peak_rss_kib;
+        }
+    }
+    best->peak_rss_kib = peak_rss_kib;
+}
+
+/**
+ * @brief Prints one line of results.
+ */
+static void report(const char *tool, const char *workload, int runs, uint64_t instructions, const RunResult *result) {
+    printf("%s\t%s\t%d\t%lu\t%.6f\t%.2f\t%ld\n", tool, workload, runs, instructions,
+           result->wall_seconds, instructions / result->wall_seconds / 1e6, result->peak_rss_kib);
+    fflush(stdout);
+}
+
+/**
+ * @brief Gets the number of instructions in an assembled image from its size.
+ */
+static uint64_t image_instructions(const char *image_path) {
+    struct stat image_stat;
+    if (stat(image_path, &image_stat) == -1) {
+        perror(image_path);
+        exit(EXIT_FAILURE);
+    }
+    return image_stat.st_size / INSTR_SIZE;
+}
+
+/**
+ * @brief Benchmarks assembling a source file, leaving the image at the given path.
+ */
+static void bench_assemble(const char *workload, const char *source_path, const char *image_path, int runs) {
+    RunResult result;
+    run_repeatedly((char *const []) {ASSEMBLE_PATH, (char *) source_path, (char *) image_path, NULL}, runs, &result);
+    report("assemble", workload, runs, image_instructions(image_path), &result);
+}
+
+/**
+ * @brief Benchmarks emulating an image.
+ */
+static void bench_emulate(const char *workload, const char *image_path, const char *output_path, int runs) {
+    RunResult result;
+    run_repeatedly((char *const []) {EMULATE_PATH, "--stats", (char *) image_path, (char *) output_path, NULL}, runs, &result);
+
+    const char *count = strstr(result.stderr_output, "Instructions: ");
+    if (count == NULL) {
+        fprintf(stderr, "emulate did not report an instruction count for %s\n", workload);
+        exit(EXIT_FAILURE);
+    }
+    report("emulate", workload, runs, strtoull(count + strlen("Instructions: "), NULL, 10), &result);
+}
+
+/**
+ * @brief Writes a large straight-line source file covering every kind of instruction, for the assembler.
+ * @param source_path Path to write the source file to.
+ */
+static void generate_large_source(const char *source_path) {
+    FILE *source = fopen(source_path, "w");
+    if (source == NULL) {
+        perror(source_path);
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < LARGE_SOURCE_BLOCKS; i++) {
+        int r = i % 30;
+        fprintf(source, "block%d:\n", i);
+        fprintf(source, "movz x%d, #0x%x, lsl #16\n", r, i & 0xffff);
+        fprintf(source, "add x%d, x%d, #%d\n", r, (r + 1) % 30, i % 4096);
+        fprintf(source, "subs w%d, w%d, w%d, lsl #%d\n", r, (r + 2) % 30, (r + 3) % 30, i % 32);
+        fprintf(source, "eor x%d, x%d, x%d, ror #%d\n", r, (r + 4) % 30, (r + 5) % 30, i % 64);
+        fprintf(source, "madd x%d, x%d, x%d, x%d\n", r, (r + 6) % 30, (r + 7) % 30, (r + 8) % 30);
+        fprintf(source, "ldr x%d, [x%d, #%d]\n", r, (r + 9) % 30, (i % 512) * 8);
+        fprintf(source, "str w%d, [x%d, #%d]!\n", r, (r + 10) % 30, (i % 256) - 128);
+        fprintf(source, "cmp x%d, x%d\n", r, (r + 11) % 30);
+        fprintf(source, "b.ne block%d\n", (i + 1) % LARGE_SOURCE_BLOCKS);
+        fprintf(source, "b block%d\n", i / 2);
+    }
+    fprintf(source, "and x0, x0, x0\n");
+
+    fclose(source);
+}
+
+/**
+ * Main function for the benchmark driver.
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line argument strings, optionally "-r runs".
+ * @return EXIT_SUCCESS if every benchmark ran, otherwise EXIT_FAILURE.
+ */
+int main(int argc, char **argv) {
+    int runs = DEFAULT_RUNS;
+    if (argc == 3 && strcmp(argv[1], "-r") == 0 && atoi(argv[2]) > 0) {
+        runs = atoi(argv[2]);
+    } else if (argc != 1) {
+        fprintf(stderr, "Usage: bench/bin/bench [-r runs]\n");
+        return EXIT_FAILURE;
+    }
+
+    mkdir(OUT_DIR, 0755);
+
+    printf("tool\tworkload\truns\tinstructions\twall_seconds\tmips\tpeak_rss_kib\n");
+
+    char source_path[PATH_SIZE], image_path[PATH_SIZE], output_path[PATH_SIZE];
+
+    for (size_t i = 0; i < NUM_WORKLOADS; i++) {
+        snprintf(source_path, PATH_SIZE, "%s/%s.s", WORKLOAD_DIR, workloads[i]);
+        snprintf(image_path, PATH_SIZE, "%s/%s.bin", OUT_DIR, workloads[i]);
+        snprintf(output_path, PATH_SIZE, "%s/%s.out", OUT_DIR, workloads[i]);
+
+        bench_assemble(workloads[i], source_path, image_path, runs);
+        bench_emulate(workloads[i], image_path, output_path, runs);
+    }
+
+    snprintf(source_path, PATH_SIZE, "%s/large.s", OUT_DIR);
+    snprintf(image_path, PATH_SIZE, "%s/large.bin", OUT_DIR);
+    generate_large_source(source_path);
+    bench_assemble("large", source_path, image_path, runs);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,11 @@
+movz x0, #0                     // Tight arithmetic loop: add, logic with shifts, multiply-add and a counted branch.
+movz x1, #0x10, lsl #16         // 1M iterations of 6 instructions.
+movz x2, #3
+loop:
+    add x0, x0, x2
+    eor x3, x0, x2, lsl #3
+    madd x4, x3, x2, x0
+    sub x5, x4, x3
+    subs x1, x1, #1
+    b.ne loop
+and x0, x0, x0
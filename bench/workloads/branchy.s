@@ -0,0 +1,27 @@
+movz x0, #1                     // Branch heavy code: a linear congruential generator steers data dependent branches.
+movz x1, #0x8, lsl #16          // 512K iterations of 11 to 13 instructions.
+movz x6, #0x4e6d
+movz x7, #0x3039
+movz x8, #0x10
+movz x10, #0x3
+loop:
+    madd x0, x0, x6, x7
+    tst x0, x8
+    b.eq skip
+    add x5, x5, #1
+skip:
+    and x9, x0, x10
+    cmp x9, #1
+    b.lt low
+    b.eq mid
+    add x13, x13, #1
+    b next
+low:
+    add x11, x11, #1
+    b next
+mid:
+    add x12, x12, #1
+next:
+    subs x1, x1, #1
+    b.ne loop
+and x0, x0, x0
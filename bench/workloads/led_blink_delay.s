@@ -0,0 +1,10 @@
+mov w0 wzr                      // The delay loop of led_blink.s with its full NUM_LOOP, without touching GPIO.
+ldr w1 NUM_LOOP                 // NUM_LOOP iterations of 3 instructions.
+loop:
+    add w0 w0 #1                // w0++
+    cmp w0 w1                   // if (w0 != NUM_LOOP);
+    b.ne loop                   // jump to loop
+and x0, x0, x0
+
+NUM_LOOP:
+    .int 0x002fffff
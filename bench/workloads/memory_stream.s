@@ -0,0 +1,13 @@
+movz x10, #8                    // Memory streaming loop: read, modify and write back 1 MiB of double words, 8 times over.
+pass:                           // 8 passes of 128K iterations of 5 instructions.
+    movz x1, #0x1000
+    movz x2, #0x2, lsl #16
+    loop:
+        ldr x3, [x1]
+        add x3, x3, #1
+        str x3, [x1], #8
+        subs x2, x2, #1
+        b.ne loop
+    subs x10, x10, #1
+    b.ne pass
+and x0, x0, x0
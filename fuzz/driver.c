@@ -0,0 +1,391 @@
+/**
+ * @file driver.c
+ * @brief Coverage-guided fuzzing driver for the harnesses, for use with gcc.
+ * @details libFuzzer needs clang, so this driver provides a small fuzzer with the same interface
+ *          for the harnesses to be linked against when building with gcc. It accepts the
+ *          libFuzzer options used by `make fuzz`:
+ *
+ *          fuzz_<harness> [-runs=N] [-max_len=N] [-timeout=SECONDS] [-seed=N]
+ *                         [-artifact_prefix=PATH] [corpus-directory...]
+ *
+ *          The code under test is compiled with -fsanitize-coverage=trace-pc, which calls
+ *          __sanitizer_cov_trace_pc at every basic block. The driver records those calls in a
+ *          bitmap shared with each child process. Every input is run in a child forked from the
+ *          driver, so that the harness can exit() on malformed input and the driver still carries
+ *          on. Inputs that reach new basic blocks are kept in the corpus and written to the first
+ *          corpus directory. Later inputs are made by mutating inputs from the corpus.
+ *
+ *          An input that kills the child with a signal, other than the abort of a failed
+ *          assert_msg, or that runs past the time out, is written to a crash- or timeout- file
+ *          under the artifact prefix, and the driver stops with a failure status.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "fuzz.h"
+
+#define COVERAGE_SIZE (1 << 16)
+#define DEFAULT_RUNS 10000
+#define DEFAULT_MAX_LEN 4096
+#define DEFAULT_TIMEOUT 1
+#define PATH_SIZE 512
+#define STDERR_BUFFER_SIZE 4096
+#define MAX_MUTATIONS 8
+
+// Message assert_msg prints before aborting, which marks an abort as a rejected input
+#define ASSERT_MESSAGE "Assertion "
+
+// An input held in the corpus
+typedef struct {
+    uint8_t *data;
+    size_t size;
+} Input;
+
+// Blocks reached by the input being run, shared with the child running it
+static uint8_t *coverage;
+// Blocks reached by any input so far
+static uint8_t seen[COVERAGE_SIZE];
+
+static Input *corpus;
+static size_t corpus_size;
+static size_t corpus_capacity;
+
+static uint64_t random_state;
+
+/**
+ * @brief Records that a basic block was reached; called by code built with -fsanitize-coverage=trace-pc.
+ */
+void __sanitizer_cov_trace_pc(void) {
+    uintptr_t pc = (uintptr_t) __builtin_return_address(0);
+    coverage[(pc ^ (pc >> 16)) & (COVERAGE_SIZE - 1)] = 1;
+}
+
+/**
+ * @brief Gets the next number from a xorshift generator.
+ */
+static uint64_t next_random(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+/**
+ * @brief Adds a copy of an input to the corpus.
+ */
+static void corpus_add(const uint8_t *data, size_t size) {
+    if (corpus_size == corpus_capacity) {
+        corpus_capacity = corpus_capacity == 0 ? 64 : corpus_capacity * 2;
+        corpus = realloc(corpus, corpus_capacity * sizeof(Input));
+    }
+    Input *input = &corpus[corpus_size++];
+    input->data = malloc(size == 0 ? 1 : size);
+    if (corpus == NULL || input->data == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(input->data, data, size);
+    input->size = size;
+}
+
+/**
+ * @brief Hashes an input, to name the files it is written to.
+ */
+static uint64_t hash_input(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001b3;
+    }
+    return hash;
+}
+
+/**
+ * @brief Writes an input to a file named by a prefix and the input's hash.
+ */
+static void write_input(const char *prefix, const char *kind, const uint8_t *data, size_t size) {
+    char path[PATH_SIZE];
+    snprintf(path, PATH_SIZE, "%s%s%016lx", prefix, kind, hash_input(data, size));
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Failed to write %s\n", path);
+        return;
+    }
+    fwrite(data, 1, size, file);
+    fclose(file);
+    if (strcmp(kind, "") != 0) {
+        fprintf(stderr, "Wrote %s\n", path);
+    }
+}
+
+// How running one input ended
+typedef enum {INPUT_OK, INPUT_CRASH, INPUT_TIMEOUT} Outcome;
+
+/**
+ * @brief Runs the harness on one input in a child process.
+ *
+ * @param data Input to run.
+ * @param size Size of the input in bytes.
+ * @param timeout Seconds the child may run for.
+ * @return How the run ended.
+ */
+static Outcome run_input(const uint8_t *data, size_t size, unsigned timeout) {
+    memset(coverage, 0, COVERAGE_SIZE);
+
+    int err_pipe[2];
+    if (pipe(err_pipe) == -1) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(err_pipe[1], STDERR_FILENO);
+        close(err_pipe[0]);
+        alarm(timeout);
+        LLVMFuzzerTestOneInput(data, size);
+        _exit(EXIT_SUCCESS);
+    }
+
+    // Keep the start of the child's stderr, to tell failed assertions apart from other aborts
+    close(err_pipe[1]);
+    char messages[STDERR_BUFFER_SIZE];
+    size_t length = 0;
+    ssize_t bytes_read;
+    while (length < STDERR_BUFFER_SIZE - 1
+           && (bytes_read = read(err_pipe[0], messages + length, STDERR_BUFFER_SIZE - 1 - length)) > 0) {
+        length += bytes_read;
+    }
+    messages[length] = '\0';
+    // Drain the rest, so that a child with a lot to say does not block on a full pipe
+    char discard[STDERR_BUFFER_SIZE];
+    while (read(err_pipe[0], discard, STDERR_BUFFER_SIZE) > 0) {
+    }
+    close(err_pipe[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+
+    if (!WIFSIGNALED(status)) {
+        return INPUT_OK;
+    }
+    if (WTERMSIG(status) == SIGALRM) {
+        return INPUT_TIMEOUT;
+    }
+    if (WTERMSIG(status) == SIGABRT && strstr(messages, ASSERT_MESSAGE) != NULL) {
+        return INPUT_OK;
+    }
+    fprintf(stderr, "Input killed by signal %d: %s\n", WTERMSIG(status), strsignal(WTERMSIG(status)));
+    if (length > 0) {
+        fprintf(stderr, "%s", messages);
+    }
+    return INPUT_CRASH;
+}
+
+/**
+ * @brief Merges the coverage of the last run into the blocks seen so far.
+ * @return true if the run reached a block no earlier input reached.
+ */
+static bool merge_coverage(void) {
+    bool new_coverage = false;
+    for (int i = 0; i < COVERAGE_SIZE; i++) {
+        if (coverage[i] && !seen[i]) {
+            seen[i] = 1;
+            new_coverage = true;
+        }
+    }
+    return new_coverage;
+}
+
+/**
+ * @brief Makes a new input by applying a few random mutations to an input from the corpus.
+ *
+ * @param buffer Buffer of max_len bytes to build the input in.
+ * @param max_len Largest input to make.
+ * @return Size of the new input.
+ */
+static size_t mutate(uint8_t *buffer, size_t max_len) {
+    size_t size = 0;
+    if (corpus_size > 0) {
+        Input *base = &corpus[next_random() % corpus_size];
+        size = base->size < max_len ? base->size : max_len;
+        memcpy(buffer, base->data, size);
+    }
+
+    int mutations = 1 + next_random() % MAX_MUTATIONS;
+    for (int m = 0; m < mutations; m++) {
+        size_t position = size == 0 ? 0 : next_random() % size;
+        switch (next_random() % 6) {
+            case 0: // Flip a bit
+                if (size > 0) buffer[position] ^= 1 << (next_random() % 8);
+                break;
+            case 1: // Set a byte at random
+                if (size > 0) buffer[position] = next_random();
+                break;
+            case 2: // Set a byte to a printable character, which suits the assembler
+                if (size > 0) buffer[position] = ' ' + next_random() % 95;
+                break;
+            case 3: // Insert a byte
+                if (size < max_len) {
+                    memmove(buffer + position + 1, buffer + position, size - position);
+                    buffer[position] = next_random() % 2 ? next_random() : ' ' + next_random() % 95;
+                    size++;
+                }
+                break;
+            case 4: // Delete a byte
+                if (size > 0) {
+                    memmove(buffer + position, buffer + position + 1, size - position - 1);
+                    size--;
+                }
+                break;
+            case 5: // Copy in part of another input from the corpus
+                if (corpus_size > 0 && size > 0) {
+                    Input *other = &corpus[next_random() % corpus_size];
+                    if (other->size > 0) {
+                        size_t from = next_random() % other->size;
+                        size_t length = 1 + next_random() % (other->size - from);
+                        if (length > size - position) length = size - position;
+                        memcpy(buffer + position, other->data + from, length);
+                    }
+                }
+                break;
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Loads every file in a directory into the corpus.
+ */
+static void load_directory(const char *directory_path, size_t max_len) {
+    DIR *directory = opendir(directory_path);
+    if (directory == NULL) {
+        mkdir(directory_path, 0755);
+        return;
+    }
+
+    uint8_t *buffer = malloc(max_len);
+    struct dirent *entry;
+    while ((entry = readdir(directory)) != NULL) {
+        char path[PATH_SIZE];
+        snprintf(path, PATH_SIZE, "%s/%s", directory_path, entry->d_name);
+        struct stat file_stat;
+        if (stat(path, &file_stat) == -1 || !S_ISREG(file_stat.st_mode)) {
+            continue;
+        }
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) {
+            continue;
+        }
+        size_t size = fread(buffer, 1, max_len, file);
+        fclose(file);
+        corpus_add(buffer, size);
+    }
+    closedir(directory);
+    free(buffer);
+}
+
+/**
+ * Main function for the fuzzing driver.
+ *
+ * Loads the corpus directories, runs every input in them, and then runs mutated inputs until
+ * the given number of runs have been made or an input crashes.
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line argument strings, libFuzzer style options then directories.
+ * @return EXIT_SUCCESS if no input crashed or timed out, otherwise EXIT_FAILURE.
+ */
+int main(int argc, char **argv) {
+    unsigned long runs = DEFAULT_RUNS;
+    size_t max_len = DEFAULT_MAX_LEN;
+    unsigned timeout = DEFAULT_TIMEOUT;
+    const char *artifact_prefix = "./";
+    const char *output_directory = NULL;
+    random_state = 0x9e3779b97f4a7c15;
+
+    for (int i = 1; i < argc; i++) {
+        if (sscanf(argv[i], "-runs=%lu", &runs) == 1 || sscanf(argv[i], "-max_len=%zu", &max_len) == 1
+            || sscanf(argv[i], "-timeout=%u", &timeout) == 1 || sscanf(argv[i], "-seed=%lu", &random_state) == 1) {
+            continue;
+        }
+        if (strncmp(argv[i], "-artifact_prefix=", strlen("-artifact_prefix=")) == 0) {
+            artifact_prefix = argv[i] + strlen("-artifact_prefix=");
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        if (output_directory == NULL) {
+            output_directory = argv[i];
+        }
+        load_directory(argv[i], max_len);
+    }
+    if (random_state == 0 || max_len == 0) {
+        fprintf(stderr, "The seed and maximum length must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    coverage = mmap(NULL, COVERAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (coverage == MAP_FAILED) {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+
+    char output_prefix[PATH_SIZE];
+    if (output_directory != NULL) {
+        snprintf(output_prefix, PATH_SIZE, "%s/", output_directory);
+    }
+
+    // Run the initial corpus first, so that mutations only keep inputs that add to it
+    size_t initial_size = corpus_size;
+    uint8_t *buffer = malloc(max_len);
+    Outcome outcome = INPUT_OK;
+    for (size_t i = 0; i < initial_size && outcome == INPUT_OK; i++) {
+        outcome = run_input(corpus[i].data, corpus[i].size, timeout);
+        merge_coverage();
+        if (outcome != INPUT_OK) {
+            write_input(artifact_prefix, outcome == INPUT_CRASH ? "crash-" : "timeout-", corpus[i].data, corpus[i].size);
+        }
+    }
+
+    unsigned long run = 0;
+    for (; run < runs && outcome == INPUT_OK; run++) {
+        size_t size = mutate(buffer, max_len);
+        outcome = run_input(buffer, size, timeout);
+
+        if (outcome != INPUT_OK) {
+            write_input(artifact_prefix, outcome == INPUT_CRASH ? "crash-" : "timeout-", buffer, size);
+        } else if (merge_coverage()) {
+            corpus_add(buffer, size);
+            if (output_directory != NULL) {
+                write_input(output_prefix, "", buffer, size);
+            }
+        }
+    }
+
+    size_t blocks = 0;
+    for (int i = 0; i < COVERAGE_SIZE; i++) {
+        blocks += seen[i];
+    }
+    fprintf(stderr, "Done %lu runs: %zu blocks covered, corpus of %zu inputs\n", run, blocks, corpus_size);
+
+    free(buffer);
+    return outcome == INPUT_OK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
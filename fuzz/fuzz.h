@@ -0,0 +1,32 @@
+/**
+ * @file fuzz.h
+ * @brief Shared declarations for the fuzzing harnesses.
+ *
+ * Each harness defines LLVMFuzzerTestOneInput, the entry point libFuzzer calls with every input
+ * it generates, so the harnesses can be linked either against libFuzzer (with clang) or against
+ * driver.c, the coverage-guided driver used with gcc.
+ *
+ * The assembler and emulator reject malformed input by raising a fault (see fault.h), which the
+ * harnesses catch so that a single process can go on to the next input. Any exit() or assert_msg
+ * abort left on an error path is also treated as a rejection, so an input counts as a crash only
+ * if it makes the harness die any other way (a segmentation fault, a failed stack check, a time
+ * out and so on).
+ */
+
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Longest assembly line the assemble harness passes on, in bytes
+#define FUZZ_MAX_LINE 256
+// Most instructions the emulate harness loads
+#define FUZZ_MAX_WORDS 1024
+// Most instructions the emulate harness runs before stopping the program
+#define FUZZ_MAX_INSTRUCTIONS 100000
+
+// Entry point called with every input, returning 0
+extern int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#endif /* FUZZ_H */
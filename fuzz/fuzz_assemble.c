@@ -0,0 +1,36 @@
+/**
+ * @file fuzz_assemble.c
+ * @brief Fuzzing harness assembling a single line of source.
+ * @details The input, up to its first newline, is decoded as one line of assembly, as assemble
+ *          does with every line of a file.
+ */
+
+#include <string.h>
+
+#include "fuzz.h"
+#include "../src/fault.h"
+#include "../src/assembler/decode.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    char line[FUZZ_MAX_LINE + 1];
+    if (size > FUZZ_MAX_LINE) {
+        size = FUZZ_MAX_LINE;
+    }
+    memcpy(line, data, size);
+    line[size] = '\0';
+
+    // assemble gives decode one line at a time and skips empty ones
+    line[strcspn(line, "\n")] = '\0';
+    if (line[0] == '\0') {
+        return 0;
+    }
+
+    decode_init();
+    FaultHandler handler;
+    if (fault_catch(&handler) == 0) {
+        decode(line);
+        fault_pop(&handler);
+    }
+    decode_free();
+    return 0;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file fuzz_decode.c
+ * @brief Fuzzing harness decoding a single instruction word.
+ * @details The first four bytes of the input are taken as an instruction, which is disassembled
+ *          and then executed once by the emulator from a freshly reset CPU.
+ */
+
+#include <string.h>
+
+#include "fuzz.h"
+#include "../src/fault.h"
+#include "../src/assembler/disassembler.h"
+#include "../src/emulator/cpu.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    uint32_t word = 0;
+    memcpy(&word, data, size < sizeof(word) ? size : sizeof(word));
+
+    char line[DISASSEMBLY_LINE_SIZE];
+    disassemble_instruction(word, 0, line);
+
+    FaultHandler handler;
+    if (fault_catch(&handler) == 0) {
+        init_cpu_buffer(&word, 1);
+        step_instruction();
+        fault_pop(&handler);
+    }
+    return 0;
+}
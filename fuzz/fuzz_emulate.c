@@ -0,0 +1,31 @@
+/**
+ * @file fuzz_emulate.c
+ * @brief Fuzzing harness running a short program.
+ * @details The input is loaded as a binary image of up to FUZZ_MAX_WORDS instructions and run
+ *          until it halts or FUZZ_MAX_INSTRUCTIONS instructions have been executed.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "fuzz.h"
+#include "../src/fault.h"
+#include "../src/emulator/cpu.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    uint32_t words[FUZZ_MAX_WORDS];
+    size_t num_words = size / sizeof(uint32_t);
+    if (num_words > FUZZ_MAX_WORDS) {
+        num_words = FUZZ_MAX_WORDS;
+    }
+    memcpy(words, data, num_words * sizeof(uint32_t));
+
+    FaultHandler handler;
+    if (fault_catch(&handler) == 0) {
+        init_cpu_buffer(words, num_words);
+        set_instruction_limit(FUZZ_MAX_INSTRUCTIONS);
+        run_cpu();
+        fault_pop(&handler);
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file mix.c
+ * @brief Example instrumentation plugin reporting the instruction mix of a run.
+ * @details Counts retired instructions, data loads and stores, and taken branches, and prints
+ *          the totals to stderr when the program halts:
+ *
+ *              make plugins
+ *              bin/emulate --plugin plugins/bin/mix.so program.bin
+ */
+
+#include <stdio.h>
+
+#include "../src/emulator/plugin.h"
+
+// Totals of the run so far
+typedef struct {
+    uint64_t instructions;
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t taken_branches;
+} Mix;
+
+static Mix mix;
+
+static void count_instruction(void *data, uint64_t pc, uint32_t instruction) {
+    ((Mix *) data)->instructions++;
+}
+
+static void count_access(void *data, uint32_t address, uint32_t size, bool is_write) {
+    Mix *totals = data;
+    if (is_write) {
+        totals->stores++;
+    } else {
+        totals->loads++;
+    }
+}
+
+static void count_branch(void *data, uint64_t from, uint64_t to) {
+    ((Mix *) data)->taken_branches++;
+}
+
+static void report(void *data, uint64_t pc) {
+    const Mix *totals = data;
+    fprintf(stderr, "Instructions retired: %lu\n", totals->instructions);
+    fprintf(stderr, "Loads: %lu\n", totals->loads);
+    fprintf(stderr, "Stores: %lu\n", totals->stores);
+    fprintf(stderr, "Taken branches: %lu\n", totals->taken_branches);
+}
+
+/**
+ * @brief Registers the plugin's callbacks; called by emulate when it loads the plugin.
+ */
+void armv8_plugin_init(void) {
+    PluginHooks hooks = {count_instruction, count_access, count_branch, report, &mix};
+    plugin_register(&hooks);
+}
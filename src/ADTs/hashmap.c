@@ -263,6 +263,26 @@ int hashmap_size(HashMap *hmap) {
     return hmap->size;
 }
 
+/**
+ * @brief Applies a callback function to each key-value pair in the hashmap.
+ *
+ * Items are visited bucket by bucket, so the order is unspecified. The callback must not
+ * add or remove items while iterating.
+ *
+ * @param hmap Pointer to the hashmap.
+ * @param call_back Callback function to apply to each key-value pair.
+ * @param state State parameter passed to the callback function.
+ */
+void hashmap_for_each(const HashMap *hmap, void (*call_back)(const char *key, void *value, void *state), void *state) {
+    assert_msg(call_back != NULL, "Callback function pointer passed in is null.\n");
+
+    for (int i = 0; i < hmap->num_buckets; i++) {
+        for (Item *item = hmap->buckets[i]; item != NULL; item = item->next) {
+            call_back(item->key, item->value, state);
+        }
+    }
+}
+
 /**
  * @brief Removes the item with the specified key from the hashmap.
  *
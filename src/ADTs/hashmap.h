@@ -33,6 +33,9 @@ extern void *hashmap_remove(HashMap *hmap, const char *key);
 // Returns the number of key-value pairs in the hash map
 extern int hashmap_size(HashMap *hmap);
 
+// Applies a callback function to each key-value pair in the hash map
+extern void hashmap_for_each(const HashMap *hmap, void (*call_back)(const char *key, void *value, void *state), void *state);
+
 // Clears all key-value pairs from the hash map, resetting its state
 extern void hashmap_clear(HashMap *hmap);
 
@@ -1,5 +1,7 @@
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 //turns on debug mode
 #define DEBUGGING_MODE
@@ -7,91 +9,217 @@
 #include "../utils.h"
 #include "../debugging.h"
 #include "../ADTs/darray.h"
+#include "../source_buffer.h"
 #include "decode.h"
 #include "decode_helper.h"
+#include "symbol_table.h"
+#include "object.h"
+#include "cache.h"
 
-#define INITIAL_BUFFER_SIZE 10
+#define INSTR_SIZE 4
+
+// A chunk of instruction lines assembled by one thread in parallel mode
+typedef struct {
+  DArray *lines;          // All instruction lines of the file (labels excluded)
+  int first_line;         // Index of the first line in this chunk
+  int end_line;           // Index one past the last line in this chunk
+  uint32_t *words;        // Per-thread buffer the chunk is assembled into
+  HashMap *references;    // Labels used in this chunk and the addresses they are used at
+} AssembleJob;
 
 /**
- * @brief Reads each line and calls the call back function. Ignores empty lines
+ * @brief Reads each line and calls the call back function. Ignores lines with no code
  *
  * @param output_file_path Path to the input assembly file.
  * @param call_back Call back function to run on every line.
  */
 static void for_each_line_in_file(const char* input_file_path, void (*call_back)(char *line)) {
-  FILE *input_file = fopen(input_file_path, "r");
-  if (input_file == NULL) {
-    fprintf(stderr, "Failed to open file %s\n", input_file_path);
-    exit(EXIT_FAILURE);
+  assert(call_back != NULL);
+
+  SourceBuffer *source = source_buffer_open(input_file_path);
+  char *line;
+
+  while (source_buffer_next_line(source, &line)) {
+    if (is_blank_line(line)) continue; //no code on the line
+
+    call_back(line);
   }
 
-  assert(input_file != NULL);
-  assert(call_back != NULL);
+  source_buffer_free(source);
+}
 
-  int buffer_size = INITIAL_BUFFER_SIZE;
-  char *buffer    = malloc(buffer_size * sizeof(char));
-  int length      = 0;
-  
-  char c;
+/**
+ * @brief Adds a label defined in the file to an object, as a symbol_table_for_each_label call back.
+ */
+static void add_object_symbol(const char *label, uint32_t address, void *object) {
+  object_add_symbol(object, label, address);
+}
 
-  while ((c = fgetc(input_file)) != EOF) {
-    if (c == '\n') {
-      if (length == 0) continue; //empty line
+/**
+ * @brief Adds a use of an undefined label to an object, as a symbol_table_for_each_unresolved call back.
+ */
+static void add_object_relocation(const char *label, uint32_t address, void *object) {
+  object_add_relocation(object, label, address);
+}
 
-      buffer[length] = '\0';
-      length = 0;
-      call_back(buffer);
-      continue;
-    } 
+/**
+ * @brief Writes the assembled instructions out, either as a flat image or as a relocatable object.
+ *
+ * Must be called before decode_free, since the symbols and relocations of an object are taken
+ * from the symbol table of the calling thread.
+ *
+ * @param output_file_path Path to the output file.
+ * @param instructions Dynamic array (DArray) containing uint32_t instructions to write.
+ * @param relocatable Whether to write a relocatable object (for the linker) instead of an image.
+ */
+static void write_output(const char *output_file_path, DArray *instructions, bool relocatable) {
+  if (!relocatable) {
+    write_image(output_file_path, instructions);
+    return;
+  }
 
-    buffer[length++] = c;
+  ObjectFile *object = object_init();
+  object_add_instructions(object, instructions);
+  symbol_table_for_each_label(add_object_symbol, object);
+  symbol_table_for_each_unresolved(add_object_relocation, object);
 
-    if (length == buffer_size) {
-      buffer_size *= 2;
-      buffer = realloc(buffer, buffer_size);
-      assert(buffer != NULL);
-    }
+  object_write(object, output_file_path);
+  object_free(object);
+}
+
+/**
+ * @brief Checks whether a line defines a label, without modifying the line.
+ *
+ * Mirrors the way decode() splits a line up: anything after a '/' is a comment and the
+ * first segment is delimited by spaces and commas.
+ *
+ * @param line Assembly line to check.
+ * @return true if the first segment of the line ends with ':', false otherwise.
+ */
+static bool is_label_line(const char *line) {
+  size_t code_length = strcspn(line, "/");
+  size_t start = strspn(line, ", ");
+  if (start >= code_length) {
+    return false;
   }
 
-  if (length != 0) { //last line did not end with \n
-    buffer[length] = '\0';
-    call_back(buffer);
+  size_t segment_length = strcspn(line + start, ", /");
+  return line[start + segment_length - 1] == ':';
+}
+
+/**
+ * @brief Assembles one chunk of instruction lines into the job's own buffer.
+ *
+ * Runs on a worker thread with its own decoder state and symbol table. No labels are defined
+ * in the worker, so every label used is left as a forward reference for the fixup pass.
+ *
+ * @param arg The AssembleJob describing the chunk.
+ * @return NULL
+ */
+static void *assemble_chunk(void *arg) {
+  AssembleJob *job = arg;
+
+  decode_init();
+  decode_set_address(job->first_line * INSTR_SIZE);
+
+  for (int i = job->first_line; i < job->end_line; i++) {
+    decode(darray_get(job->lines, i));
   }
 
-  free(buffer);
+  DArray *chunk_instructions = decode_get_instructions();
+  // A chunk may be empty when there are more threads than lines, and malloc(0) may return NULL
+  int num_lines = job->end_line - job->first_line;
+  job->words = malloc((num_lines > 0 ? num_lines : 1) * sizeof(uint32_t));
+  assert_msg(job->words != NULL, "Memory allocation failed\n");
+
+  for (int i = 0; i < darray_length(chunk_instructions); i++) {
+    job->words[i] = *(uint32_t *) darray_get(chunk_instructions, i);
+  }
+
+  job->references = symbol_table_release_references();
+  decode_free();
+  return NULL;
 }
 
 /**
- * @brief Writes an array of instructions to a binary file.
+ * @brief Assembles a file using several threads.
  *
- * This function opens a binary file specified by `output_file_path` in write mode ("wb").
- * It then iterates through the provided dynamic array `instructions`, writing each uint32_t
- * element to the file. If any errors occur during file operations, such as failure to open
- * or write to the file, the function prints an error message to stderr and exits the program.
+ * First a serial pass defines every label, since a label's address only depends on the number
+ * of instructions before it. The instruction lines are then split into equal chunks that are
+ * encoded in parallel, and a final serial pass patches the label references each chunk recorded.
  *
+ * @param input_file_path Path to the input assembly file.
  * @param output_file_path Path to the output binary file.
- * @param instructions Dynamic array (DArray) containing uint32_t instructions to write.
+ * @param num_threads Number of threads to assemble with.
+ * @param relocatable Whether to write a relocatable object instead of an image.
  */
-static void write_to_binray_file(const char *output_file_path, DArray *instructions) {
-  FILE *output_file = fopen(output_file_path, "wb");
-  if (output_file == NULL) {
-    fprintf(stderr, "Failed to open file %s\n", output_file_path);
-    exit(EXIT_FAILURE);
+static void assemble_parallel(const char *input_file_path, const char *output_file_path, int num_threads, bool relocatable) {
+  decode_init();
+
+  SourceBuffer *source = source_buffer_open(input_file_path);
+  DArray *lines = darray_init(NULL);
+  char *line;
+
+  // Define the labels, and gather up the instruction lines for the workers
+  while (source_buffer_next_line(source, &line)) {
+    if (is_blank_line(line)) continue; //no code on the line
+
+    if (is_label_line(line)) {
+      decode_set_address(darray_length(lines) * INSTR_SIZE);
+      decode(line);
+      continue;
+    }
+
+    darray_add(lines, line);
+  }
+
+  int num_lines = darray_length(lines);
+  if (num_threads > num_lines) {
+    num_threads = num_lines > 0 ? num_lines : 1;
+  }
+
+  AssembleJob *jobs = malloc(num_threads * sizeof(AssembleJob));
+  pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+  assert_msg(jobs != NULL && threads != NULL, "Memory allocation failed\n");
+
+  for (int i = 0; i < num_threads; i++) {
+    jobs[i].lines      = lines;
+    jobs[i].first_line = (long) num_lines * i / num_threads;
+    jobs[i].end_line   = (long) num_lines * (i + 1) / num_threads;
+    assert_msg(pthread_create(&threads[i], NULL, assemble_chunk, &jobs[i]) == 0, "Failed to create thread\n");
   }
 
-  assert_msg(instructions != NULL, "Instructions DArray passed in is empty\n");
+  for (int i = 0; i < num_threads; i++) {
+    pthread_join(threads[i], NULL);
+  }
 
-  int index = 0;
-  uint32_t *pbinary;
+  // Fixup pass: stitch the chunks back together and patch in the label addresses
+  DArray *instructions = darray_init(NULL);
+  for (int i = 0; i < num_threads; i++) {
+    for (int j = 0; j < jobs[i].end_line - jobs[i].first_line; j++) {
+      darray_add(instructions, &jobs[i].words[j]);
+    }
+  }
 
-  while (darray_iterator(instructions, &index, (void **) &pbinary)) {
-    assert_msg(fwrite(pbinary, sizeof(uint32_t), 1, output_file) == 1, "Failed to write to file %s\n", output_file_path);
+  for (int i = 0; i < num_threads; i++) {
+    symbol_table_resolve_references(instructions, jobs[i].references);
+    hashmap_free(jobs[i].references);
   }
 
-  fclose(output_file);
+  write_output(output_file_path, instructions, relocatable);
+
+  for (int i = 0; i < num_threads; i++) {
+    free(jobs[i].words);
+  }
+  free(jobs);
+  free(threads);
+  darray_free(instructions);
+  darray_free(lines);
+  source_buffer_free(source);
+  decode_free();
 }
 
-void assemble (const char *input_file_path, const char *output_file_path) {
+void assemble (const char *input_file_path, const char *output_file_path, bool relocatable) {
   // Initialize decoding process
     decode_init();
 
@@ -101,8 +229,8 @@ void assemble (const char *input_file_path, const char *output_file_path) {
     // Get decoded instructions
     DArray *instructions = decode_get_instructions();
     
-    // Write instructions to binary output file
-    write_to_binray_file(output_file_path, instructions);
+    // Write instructions to binary output file, or to an object file for the linker
+    write_output(output_file_path, instructions, relocatable);
 
     // Free resources used during decoding
     decode_free();
@@ -111,26 +239,70 @@ void assemble (const char *input_file_path, const char *output_file_path) {
 /**
  * Main function for an assembly language assembler.
  *
- * Parses command-line arguments for input and output file paths.
+ * Parses command-line arguments for input and output file paths, the optional "-j N"
+ * option to assemble with N threads, and the optional "-c" option to write a relocatable
+ * object file for bin/link instead of a flat binary image. With "--cache-dir DIR" the
+ * output is copied out of the cache when the same source has been assembled before.
  * Initializes the decoding process.
  * Decodes each line of the input file into instructions.
  * Writes the decoded instructions to the output binary file.
  * Frees resources used during decoding.
  *
- * @param argc Number of command-line arguments (must be 3).
- * @param argv Array of command-line argument strings containing input-file and output-file paths.
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line argument strings containing options, then input-file and output-file paths.
  * @return EXIT_SUCCESS if the program executes successfully, otherwise EXIT_FAILURE.
  */
 int main(int argc, char **argv) {
-  if (argc != 3) {
-    fprintf(stderr, "Usage: ./assemble input-file output-file\n");
+  int num_threads = 1;
+  bool relocatable = false;
+  char *cache_dir = NULL;
+  int arg_index = 1;
+
+  // Options all come before the file paths
+  while (arg_index < argc - 2) {
+    if (strcmp(argv[arg_index], "-j") == 0 && atoi(argv[arg_index + 1]) > 0) {
+      num_threads = atoi(argv[arg_index + 1]);
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--cache-dir") == 0) {
+      cache_dir = argv[arg_index + 1];
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "-c") == 0) {
+      relocatable = true;
+      arg_index++;
+      continue;
+    }
+    break;
+  }
+
+  if (argc - arg_index != 2) {
+    fprintf(stderr, "Usage: ./assemble [-j threads] [-c] [--cache-dir dir] input-file output-file\n");
     return EXIT_FAILURE;
   }
 
-  char *input_file_path = argv[1];
-  char *output_file_path = argv[2];
+  char *input_file_path = argv[arg_index];
+  char *output_file_path = argv[arg_index + 1];
+
+  // The source is hashed once, for both the lookup and the store after a miss
+  char *entry_path = cache_dir != NULL ? cache_entry_path(cache_dir, input_file_path, relocatable) : NULL;
+  if (entry_path != NULL && cache_lookup(entry_path, output_file_path)) {
+    free(entry_path);
+    return EXIT_SUCCESS;
+  }
+
+  if (num_threads > 1) {
+    assemble_parallel(input_file_path, output_file_path, num_threads, relocatable);
+  } else {
+    assemble(input_file_path, output_file_path, relocatable);
+  }
 
-  assemble(input_file_path, output_file_path);
+  if (entry_path != NULL) {
+    cache_store(cache_dir, entry_path, output_file_path);
+    free(entry_path);
+  }
 
   return EXIT_SUCCESS;
 }
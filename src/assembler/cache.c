@@ -0,0 +1,163 @@
+/**
+ * @file cache.c
+ * @brief Implementation file for the on-disk cache of assembler output.
+ *
+ * Each cached output lives in its own file in the cache directory, named after the 64 bit
+ * FNV-1a hash of the source contents, the assembler version and the kind of output. Entries
+ * are written to a temporary file and renamed into place, so concurrent builds sharing a cache
+ * directory never see a partially written entry.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "../utils.h"
+#include "../source_buffer.h"
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325
+#define FNV_PRIME 0x100000001b3
+#define COPY_BUFFER_SIZE 65536
+
+/**
+ * @brief Folds a block of bytes into a 64 bit FNV-1a hash.
+ * @param hash Hash of everything before the block.
+ * @param bytes Block of bytes to hash.
+ * @param length Number of bytes in the block.
+ * @return Hash including the block.
+ */
+static uint64_t fnv1a(uint64_t hash, const char *bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char) bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/**
+ * @brief Builds the path of the cache entry for a source file.
+ *
+ * The source is read and hashed here once, and the path is then passed to both cache_lookup and,
+ * on a miss, cache_store.
+ *
+ * @param cache_dir Directory holding the cache.
+ * @param input_file_path Path to the source file.
+ * @param relocatable Whether the output is a relocatable object rather than an image.
+ * @return Newly allocated path of the cache entry, to be freed by the caller.
+ */
+char *cache_entry_path(const char *cache_dir, const char *input_file_path, bool relocatable) {
+    SourceBuffer *source = source_buffer_open(input_file_path);
+    size_t length;
+    const char *contents = source_buffer_contents(source, &length);
+
+    uint64_t hash = fnv1a(FNV_OFFSET_BASIS, contents, length);
+    hash = fnv1a(hash, ASSEMBLER_VERSION, sizeof(ASSEMBLER_VERSION));
+    hash = fnv1a(hash, relocatable ? "o" : "img", relocatable ? 1 : 3);
+
+    source_buffer_free(source);
+
+    // Directory, '/', 16 hex digits, extension and '\0'
+    size_t path_length = strlen(cache_dir) + 1 + 16 + 4 + 1;
+    char *path = malloc(path_length);
+    assert_msg(path != NULL, "Memory allocation failed\n");
+    snprintf(path, path_length, "%s/%016llx%s", cache_dir, (unsigned long long) hash, relocatable ? ".o" : ".img");
+
+    return path;
+}
+
+/**
+ * @brief Copies the contents of one file descriptor to another.
+ * @param from File descriptor to read from.
+ * @param to File descriptor to write to.
+ * @return true if everything was copied, false on any read or write error.
+ */
+static bool copy_contents(int from, int to) {
+    char buffer[COPY_BUFFER_SIZE];
+    ssize_t bytes_read;
+
+    while ((bytes_read = read(from, buffer, COPY_BUFFER_SIZE)) > 0) {
+        ssize_t bytes_written = 0;
+        while (bytes_written < bytes_read) {
+            ssize_t result = write(to, buffer + bytes_written, bytes_read - bytes_written);
+            if (result < 0) {
+                return false;
+            }
+            bytes_written += result;
+        }
+    }
+
+    return bytes_read == 0;
+}
+
+/**
+ * @brief Copies the cached output for a source file to the output path, if there is one.
+ *
+ * @param entry_path Path of the source file's cache entry, from cache_entry_path.
+ * @param output_file_path Path to write the output to.
+ * @return true on a cache hit, false if the source file has to be assembled.
+ *
+ * @note The function exits the program with a failure status if the output file cannot be written.
+ */
+bool cache_lookup(const char *entry_path, const char *output_file_path) {
+    int entry = open(entry_path, O_RDONLY);
+
+    if (entry == -1) {
+        return false;
+    }
+
+    int output = open(output_file_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (output == -1) {
+        fprintf(stderr, "Failed to open file %s\n", output_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    assert_msg(copy_contents(entry, output), "Failed to write to file %s\n", output_file_path);
+
+    close(entry);
+    close(output);
+    return true;
+}
+
+/**
+ * @brief Stores the output just assembled from a source file in the cache.
+ *
+ * The cache directory is created if it does not exist yet. Failing to store an entry only
+ * prints a warning, since the output itself has already been written.
+ *
+ * @param cache_dir Directory holding the cache.
+ * @param entry_path Path of the source file's cache entry, from cache_entry_path.
+ * @param output_file_path Path the output was written to.
+ */
+void cache_store(const char *cache_dir, const char *entry_path, const char *output_file_path) {
+    if (mkdir(cache_dir, 0755) == -1 && errno != EEXIST) {
+        fprintf(stderr, "Warning: failed to create cache directory %s\n", cache_dir);
+        return;
+    }
+
+    size_t temp_length = strlen(cache_dir) + sizeof("/tmp.XXXXXX");
+    char *temp_path = malloc(temp_length);
+    assert_msg(temp_path != NULL, "Memory allocation failed\n");
+    snprintf(temp_path, temp_length, "%s/tmp.XXXXXX", cache_dir);
+
+    // mkstemp creates the file readable by its owner only, but the cache may be shared
+    int entry = mkstemp(temp_path);
+    int output = open(output_file_path, O_RDONLY);
+    bool stored = entry != -1 && output != -1 && fchmod(entry, 0644) == 0 && copy_contents(output, entry);
+
+    if (entry != -1) close(entry);
+    if (output != -1) close(output);
+
+    // Renaming makes the complete entry visible to other builds in one step
+    if (!stored || rename(temp_path, entry_path) == -1) {
+        fprintf(stderr, "Warning: failed to store %s in cache directory %s\n", output_file_path, cache_dir);
+        if (entry != -1) unlink(temp_path);
+    }
+
+    free(temp_path);
+}
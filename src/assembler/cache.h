@@ -0,0 +1,27 @@
+/**
+ * @file cache.h
+ * @brief Header file for the on-disk cache of assembler output.
+ *
+ * Outputs are stored under a key hashed from the contents of the source file, the assembler
+ * version and the kind of output (image or relocatable object), so an unchanged source file
+ * can be copied straight out of the cache instead of being assembled again.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+
+// Bump whenever a change to the assembler changes the output for the same source
+#define ASSEMBLER_VERSION "1"
+
+// Hash a source file into the path of its cache entry, to be freed by the caller.
+extern char *cache_entry_path(const char *cache_dir, const char *input_file_path, bool relocatable);
+
+// Copy the output cached at an entry path to the output path, returning false on a miss.
+extern bool cache_lookup(const char *entry_path, const char *output_file_path);
+
+// Store the output just assembled at an entry path in the cache.
+extern void cache_store(const char *cache_dir, const char *entry_path, const char *output_file_path);
+
+#endif /* CACHE_H */
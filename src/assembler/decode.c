@@ -17,6 +17,7 @@
 #include "decode_helper.h"
 #include "../instructions.h"
 #include "../utils.h"
+#include "../fault.h"
 #include "../debugging.h"
 #include "../ADTs/darray.h"
 
@@ -24,8 +25,9 @@
 
 #define INSTR_SIZE 4
 
-static DArray *instructions;
-static uint32_t current_address;
+// Thread local so that separate threads can each assemble a chunk of the same file
+static _Thread_local DArray *instructions;
+static _Thread_local uint32_t current_address;
 
 // ----------------------------------------ASSEMBLE FUNCS:---------------------------------------
 
@@ -41,6 +43,31 @@ void decode_init(void) {
     current_address = 0;
 }
 
+/**
+ * @brief Sets the address that the next decoded instruction will be placed at.
+ *
+ * Used when assembling a chunk of a file that does not start at address zero.
+ *
+ * @param address Address of the next instruction.
+ */
+void decode_set_address(uint32_t address) {
+    current_address = address;
+}
+
+/**
+ * @brief Checks whether a line holds no code, only separators or a comment.
+ *
+ * Uses the same delimiters as decode(): anything after a '/' is a comment, and spaces and
+ * commas separate segments. Callers skip such lines before decoding, so that they never take
+ * up an instruction slot, whether the file is assembled serially, in parallel or in memory.
+ *
+ * @param line Assembly line to check.
+ * @return true if the line decodes to nothing, false otherwise.
+ */
+bool is_blank_line(const char *line) {
+    return strspn(line, ", ") >= strcspn(line, "/");
+}
+
 /* Assembles madd and msub instructions. Any aliases are converted beforehand. */
 static uint32_t assemble_multiply(char *opcode, char **operands){
     //PRECONDITION: At least 4 operands:
@@ -218,8 +245,7 @@ static uint32_t assemble_load_store(char *opcode, char **operands){
         } else if (is_immediate(operands[OPERAND_2])) {
             inst.dt_load_literal.simm19 = read_imm_value(operands[OPERAND_2]) / INSTR_SIZE;
         } else {
-            fprintf(stderr, "Unknown operand: %s\n", operands[OPERAND_2]);
-            exit(EXIT_FAILURE);
+            fault_raise("Unknown operand: %s\n", operands[OPERAND_2]);
         }
 
         return inst.data;
@@ -278,8 +304,7 @@ static uint32_t assemble_load_store(char *opcode, char **operands){
         return inst.data;
     }
 
-    fprintf(stderr, "ERROR: Unknown load/store type received: %s\n", opcode);
-    exit(EXIT_FAILURE);
+    fault_raise("ERROR: Unknown load/store type received: %s\n", opcode);
 }
 
 /* Assembles b, br, b.cond instructions. Any aliases are converted beforehand. */
@@ -297,7 +322,9 @@ static uint32_t assemble_branch(char *opcode, char **operands){
     if (strcmp(opcode, opcode_names[OP_B]) == 0){
         inst.branch_unconditional.id = ITP_BRANCH_UNCOND;
 
-        assert_msg(is_label_literal(operands[OPERAND_1]), "First operand: %s is not a label\n", operands[OPERAND_1]);
+        if (!is_label_literal(operands[OPERAND_1])) {
+            fault_raise("First operand: %s is not a label\n", operands[OPERAND_1]);
+        }
         inst.branch_unconditional.simm26 = symbol_table_get_address(current_address, operands[OPERAND_1]);
 
         return inst.data;
@@ -307,7 +334,9 @@ static uint32_t assemble_branch(char *opcode, char **operands){
         inst.branch_conditional.id = ITP_BRANCH_COND;
         inst.branch_conditional.cond = read_branch_cond_type(opcode);
         
-        assert_msg(is_label_literal(operands[OPERAND_1]), "First operand: %s is not a label\n", operands[OPERAND_1]);
+        if (!is_label_literal(operands[OPERAND_1])) {
+            fault_raise("First operand: %s is not a label\n", operands[OPERAND_1]);
+        }
         inst.branch_conditional.simm19 = symbol_table_get_address(current_address, operands[OPERAND_1]);
 
         return inst.data;
@@ -320,8 +349,7 @@ static uint32_t assemble_branch(char *opcode, char **operands){
         return inst.data;
     }
 
-    fprintf(stderr, "ERROR: Unknown branch instruction type received: %s\n", opcode);
-    exit(EXIT_FAILURE);
+    fault_raise("ERROR: Unknown branch instruction type received: %s\n", opcode);
 }
 
 // ----------------------------------------MAIN FUNCS:---------------------------------------
@@ -436,7 +464,9 @@ static void convert_aliases(char *opcode, char **operands){
  */
 static uint32_t determine_and_assemble(char *opcode, char **operands){
     if (is_directive(opcode)) {
-        assert_msg(is_int_directive(opcode), "Unknown directive\n");
+        if (!is_int_directive(opcode)) {
+            fault_raise("Unknown directive\n");
+        }
         return read_imm_value(operands[OPERAND_1]);
     }
 
@@ -460,32 +490,26 @@ static uint32_t determine_and_assemble(char *opcode, char **operands){
     if (is_opcode(opcode, (Opcode[]) {OP_B, OP_BR}, NUM_BRANCH_INSTS) || strncmp(opcode, opcode_names[OP_B_COND], 2) == 0){
         return assemble_branch(opcode, operands);
     }
-    fprintf(stderr, "ERROR: Haven't implemented this function type: %s\n", opcode);
-    exit(EXIT_FAILURE);
+    fault_raise("ERROR: Haven't implemented this function type: %s\n", opcode);
 }
 
 /**
  * Decodes an assembly line input, extracts opcode and operands,
- * converts opcode aliases, assembles the instruction, and returns
- * the assembled 32-bit instruction.
+ * converts opcode aliases, assembles the instruction, and adds
+ * the assembled 32-bit instruction to the instructions array.
  *
  * @param assembly_line_input The assembly line input string to decode.
- * @return The assembled 32-bit instruction.
  * @remarks This function processes the assembly line input to determine
  *          the opcode and its associated operands. It handles special cases
- *          such as HALT instructions and labels, prints errors for unhandled
- *          labels, and converts opcode aliases before assembling the final  } else if (is_immediate(operands[OPERAND_2])) {
-            inst.dt_load_literal.simm19 = read_imm_value(operands[OPERAND_2]) / INSTR_SIZE;
-        } else {
-            fprintf(stderr, "Unknown operand: %s\n", operands[OPERAND_2]);
-            exit(EXIT_FAILURE);
-        }
-
-       
- *          instruction using the `determine_and_assemble` function.
+ *          such as comments and labels, and converts opcode aliases before
+ *          assembling the final instruction using the `determine_and_assemble`
+ *          function. An unknown opcode, too many operands or an operand that
+ *          cannot be assembled raises a fault (see fault.h).
  */
 void decode(char *assembly_line_input){
-    strtok(assembly_line_input, "/");
+    // strtok_r rather than strtok as lines may be decoded on several threads at once
+    char *save_ptr;
+    strtok_r(assembly_line_input, "/", &save_ptr);
 
     // Initialise operands
     char opcode[OPCODE_SIZE];
@@ -495,7 +519,12 @@ void decode(char *assembly_line_input){
     }
 
     // Extract the opcode/branch name segment
-    char *segment = strtok(assembly_line_input, ", ");
+    char *segment = strtok_r(assembly_line_input, ", ", &save_ptr);
+
+    // Nothing but separators and comments
+    if (segment == NULL) {
+        return;
+    }
 
     if (is_label(segment)) {
         segment[strlen(segment) - 1] = '\0'; //remove the :
@@ -503,12 +532,18 @@ void decode(char *assembly_line_input){
         return;
     }
 
+    if (strlen(segment) >= OPCODE_SIZE) {
+        fault_raise("ERROR: Unknown opcode: %s\n", segment);
+    }
     strcpy(opcode, segment);
 
     int num_ops = 0;
     
     // Loop through the string to extract all other segments
-    while((segment = strtok(NULL, ", ")) != NULL) {
+    while((segment = strtok_r(NULL, ", ", &save_ptr)) != NULL) {
+        if (num_ops == MAX_NUM_OPERANDS) {
+            fault_raise("ERROR: Too many operands for %s\n", opcode);
+        }
         operands[num_ops] = segment;
         num_ops++;
     }
@@ -521,12 +556,13 @@ void decode(char *assembly_line_input){
         debug_printf("OPERAND %d: %s\n", i+1, operands[i]);
     }
 
+    // Assemble instruction, before allocating for it so that nothing is leaked if it faults
+    uint32_t assembled = determine_and_assemble(opcode, operands);
+
     // Make space in instructions buffer for new instruction
     uint32_t *inst = malloc(sizeof(uint32_t));
     assert_msg(inst != NULL, "Memory allocation failed\n");
-
-    // Assemble instruction
-    *inst = determine_and_assemble(opcode, operands);
+    *inst = assembled;
 
     // Adds assembled instruction to instructions buffer
     darray_add(instructions, inst);
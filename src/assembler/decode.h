@@ -10,11 +10,14 @@
 #ifndef DECODE_H
 #define DECODE_H
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "symbol_table.h"
 #include "../ADTs/hashmap.h"
 
 extern void decode_init(void);
+extern void decode_set_address(uint32_t address);
+extern bool is_blank_line(const char *line);
 extern void decode(char * assembly_line);
 extern DArray *decode_get_instructions(void);
 extern void decode_free(void);
@@ -19,6 +19,7 @@
 
 #include "decode_helper.h"
 #include "../utils.h"
+#include "../fault.h"
 
 // Branch Instructions
 #define IS_LABEL ':'
@@ -121,7 +122,12 @@ bool is_int_directive(char *str) {
  * @return Unsigned integer value of the register index.
  */
 unsigned int read_reg_value(char * opcode_segment){
-    assert_msg(is_valid_register(opcode_segment), "The register passed into read_reg_value \"%s\" is invalid.", opcode_segment);
+    if (opcode_segment == NULL) {
+        fault_raise("Missing register operand\n");
+    }
+    if (!is_valid_register(opcode_segment)) {
+        fault_raise("The register passed into read_reg_value \"%s\" is invalid.", opcode_segment);
+    }
     if (is_zero_register(opcode_segment)){
         return ZERO_REGISTER_INDEX;
     }
@@ -138,6 +144,9 @@ unsigned int read_reg_value(char * opcode_segment){
  * @return uint32_t value of the immediate.
  */
 uint32_t read_imm_value(char * opcode_segment){
+    if (opcode_segment == NULL) {
+        fault_raise("Missing immediate operand\n");
+    }
     if (is_immediate(opcode_segment)) {
         opcode_segment++; //To remove #
     }
@@ -161,6 +170,9 @@ uint32_t read_imm_value(char * opcode_segment){
  * @return Unsigned integer encoding of the shift type.
  */
 unsigned int read_shift_type(char *opcode_segment){
+    if (opcode_segment == NULL) {
+        fault_raise("Missing shift operand\n");
+    }
     if (strcmp(opcode_segment, opcode_names[OP_LSL]) == 0){
         return ITP_LSL;
     }
@@ -173,8 +185,7 @@ unsigned int read_shift_type(char *opcode_segment){
     if (strcmp(opcode_segment, opcode_names[OP_ROR]) == 0){
         return ITP_ROR;
     }
-    fprintf(stderr, "ERROR: Unrecognised shift name included: %s\n", opcode_segment);
-    exit(EXIT_FAILURE);
+    fault_raise("ERROR: Unrecognised shift name included: %s\n", opcode_segment);
 }
 
 /**
@@ -187,7 +198,9 @@ unsigned int read_shift_type(char *opcode_segment){
  */
 
 unsigned int read_branch_cond_type(char *opcode_segment){
-    assert_msg(strncmp(opcode_segment, opcode_names[OP_B_COND], 2) == 0, "The instruction passed in to read_branch_cond_type \"%s\" is not a branch condition instruction (no beginning \"br\")", opcode_segment);
+    if (strncmp(opcode_segment, opcode_names[OP_B_COND], 2) != 0) {
+        fault_raise("The instruction passed in to read_branch_cond_type \"%s\" is not a branch condition instruction (no beginning \"br\")", opcode_segment);
+    }
 
     //"Remove the b."
     opcode_segment++;
@@ -215,8 +228,7 @@ unsigned int read_branch_cond_type(char *opcode_segment){
         return ITP_AL;
     }
 
-    fprintf(stderr, "ERROR: Unrecognised branch condition name included: %s\n", opcode_segment);
-    exit(EXIT_FAILURE);
+    fault_raise("ERROR: Unrecognised branch condition name included: %s\n", opcode_segment);
 }
 
 /**
@@ -252,6 +264,8 @@ bool is_opcode(const char *opcode, Opcode *opcodes, int num_opcodes) {
  */
 void assert_num_opcodes(char **operands, int num_required){
     for (int i = 0; i < num_required; i++){
-        assert_msg(operands[i] != NULL, "Not enough arguments - Number of required arguments: %d | Number of arguments: %d\n", num_required, i);
+        if (operands[i] == NULL) {
+            fault_raise("Not enough arguments - Number of required arguments: %d | Number of arguments: %d\n", num_required, i);
+        }
     }
 }
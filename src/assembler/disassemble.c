@@ -0,0 +1,74 @@
+/**
+ * @file disassemble.c
+ * @brief Source file for the "disassemble" executable.
+ * @details Reads a flat binary image, as written by `assemble` or `link`, and writes it back out
+ *          as assembly source that `assemble` turns into the same image. The whole image is read
+ *          in one go and the output is written through one large buffer, so big images are
+ *          disassembled quickly.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "disassembler.h"
+#include "../utils.h"
+#include "../source_buffer.h"
+
+#define INSTR_SIZE 4
+#define OUTPUT_BUFFER_SIZE (1 << 16)
+
+/**
+ * Main function for the disassembler.
+ *
+ * Parses command-line arguments for the input image path, an optional output file path (stdout
+ * if left out) and the optional "-a" option to annotate every line with its address and encoding.
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line argument strings.
+ * @return EXIT_SUCCESS if the program executes successfully, otherwise EXIT_FAILURE.
+ */
+int main(int argc, char **argv) {
+    bool annotate = false;
+    int arg_index = 1;
+
+    if (arg_index < argc && strcmp(argv[arg_index], "-a") == 0) {
+        annotate = true;
+        arg_index++;
+    }
+
+    if (argc - arg_index != 1 && argc - arg_index != 2) {
+        fprintf(stderr, "Usage: ./disassemble [-a] input-file [output-file]\n");
+        return EXIT_FAILURE;
+    }
+
+    SourceBuffer *image = source_buffer_open(argv[arg_index]);
+    size_t length;
+    const char *contents = source_buffer_contents(image, &length);
+
+    if (length % INSTR_SIZE != 0) {
+        fprintf(stderr, "File %s is not a whole number of instructions\n", argv[arg_index]);
+        return EXIT_FAILURE;
+    }
+
+    // The buffer comes from malloc, so it is suitably aligned for uint32_t
+    const uint32_t *words = (const uint32_t *) contents;
+
+    FILE *output_file = stdout;
+    if (argc - arg_index == 2) {
+        output_file = fopen(argv[arg_index + 1], "w");
+        if (output_file == NULL) {
+            fprintf(stderr, "Failed to open file %s\n", argv[arg_index + 1]);
+            return EXIT_FAILURE;
+        }
+    }
+    setvbuf(output_file, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    disassemble_image(words, length / INSTR_SIZE, output_file, annotate);
+
+    if (output_file != stdout) {
+        fclose(output_file);
+    }
+    source_buffer_free(image);
+
+    return EXIT_SUCCESS;
+}
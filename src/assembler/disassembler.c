@@ -0,0 +1,429 @@
+/**
+ * @file disassembler.c
+ * @brief Implementation file for turning 32-bit machine code back into assembly source.
+ *
+ * Each instruction class the assembler can produce is described by an entry in the `encodings`
+ * table: a mask of the bits the assembler always sets the same way, the value of those bits, and
+ * a function that prints the remaining fields using the layouts in instructions.h and the names
+ * in `opcode_names`. A word is disassembled by the first entry whose fixed bits match it.
+ *
+ * Aliases (cmp, neg, mov, mul...) are printed wherever the assembler would have expanded them
+ * into the same word, so that the output reads like the source it was assembled from.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "disassembler.h"
+#include "decode_helper.h"
+#include "../utils.h"
+
+#define INSTR_SIZE 4
+#define SIMM9_BITS 9
+#define SIMM19_BITS 19
+#define SIMM26_BITS 26
+#define REG_NAME_SIZE 4
+#define SHIFT_SUFFIX_SIZE 16
+
+// Prints the fields of an instruction, returning false if it cannot be printed so that it reassembles
+typedef bool (*Formatter)(Instruction inst, uint32_t address, char *buffer);
+
+typedef struct {
+    uint32_t mask;      // Bits that are the same for every instruction of the class
+    uint32_t value;     // Value of those bits
+    Formatter format;   // Prints an instruction of the class
+} Encoding;
+
+// Opcode of an arithmetic instruction, indexed by opc_op * 2 + opc_flag
+static const Opcode arith_opcodes[] = {OP_ADD, OP_ADDS, OP_SUB, OP_SUBS};
+
+// Opcode of a logic instruction, indexed by opc then N
+static const Opcode logic_opcodes[][2] = {
+    [ITP_AND] = {OP_AND, OP_BIC}, [ITP_OR] = {OP_ORR, OP_ORN},
+    [ITP_XOR] = {OP_EOR, OP_EON}, [ITP_AND_W_FLAGS] = {OP_ANDS, OP_BICS},
+};
+
+// Opcode of a wide move, indexed by opc, or NUM_OPCODES if there is no such wide move
+static const Opcode wide_move_opcodes[] = {OP_MOVN, NUM_OPCODES, OP_MOVZ, OP_MOVK};
+
+// Opcode of a branch condition, indexed by cond, or NUM_OPCODES if the assembler has no such condition
+static const Opcode condition_opcodes[] = {
+    OP_EQ, OP_NE, NUM_OPCODES, NUM_OPCODES, NUM_OPCODES, NUM_OPCODES, NUM_OPCODES, NUM_OPCODES,
+    NUM_OPCODES, NUM_OPCODES, OP_GE, OP_LT, OP_GT, OP_LE, OP_AL, NUM_OPCODES,
+};
+
+/**
+ * @brief Writes the name of a register, e.g. "x3" or "wzr".
+ * @param name Buffer of REG_NAME_SIZE characters to write to.
+ * @param reg_num Number of the register, where 31 is the zero register.
+ * @param sf Whether the register is used in 64-bit mode.
+ */
+static void reg_name(char *name, uint32_t reg_num, bool sf) {
+    if (reg_num == ZERO_REGISTER_INDEX) {
+        snprintf(name, REG_NAME_SIZE, "%czr", sf ? 'x' : 'w');
+        return;
+    }
+    snprintf(name, REG_NAME_SIZE, "%c%u", sf ? 'x' : 'w', reg_num);
+}
+
+/**
+ * @brief Writes the optional shift of a register operand, e.g. ", lsl #4", or nothing for no shift.
+ * @param suffix Buffer of SHIFT_SUFFIX_SIZE characters to write to.
+ * @param shift Shift type.
+ * @param amount Shift amount.
+ */
+static void shift_suffix(char *suffix, uint32_t shift, uint32_t amount) {
+    if (shift == ITP_LSL && amount == 0) {
+        suffix[0] = '\0';
+        return;
+    }
+    snprintf(suffix, SHIFT_SUFFIX_SIZE, ", %s #%u", opcode_names[OP_LSL + shift], amount);
+}
+
+/**
+ * @brief Writes the label the disassembler uses for an address.
+ * @param buffer Buffer to write to.
+ * @param size Size of the buffer.
+ * @param target Address the label refers to.
+ */
+static void label_name(char *buffer, size_t size, uint32_t target) {
+    snprintf(buffer, size, "L%x", target);
+}
+
+// ----------------------------------------FORMATTERS:---------------------------------------
+
+/* Prints add, adds, sub, subs with an immediate, along with the cmp, cmn, neg and negs aliases. */
+static bool format_imm_arith(Instruction inst, uint32_t address, char *buffer) {
+    ImmArith arith = inst.imm_arith;
+    char rd[REG_NAME_SIZE], rn[REG_NAME_SIZE];
+    reg_name(rd, arith.rd, arith.sf);
+    reg_name(rn, arith.rn, arith.sf);
+    const char *shift = arith.sh ? ", lsl #12" : "";
+
+    if (arith.opc_flag && arith.rd == ZERO_REGISTER_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, #0x%x%s", opcode_names[arith.opc_op ? OP_CMP : OP_CMN], rn, arith.imm12, shift);
+        return true;
+    }
+    if (arith.opc_op && arith.rn == ZERO_REGISTER_INDEX && arith.rd != ZERO_REGISTER_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, #0x%x%s", opcode_names[arith.opc_flag ? OP_NEGS : OP_NEG], rd, arith.imm12, shift);
+        return true;
+    }
+
+    Opcode opcode = arith_opcodes[arith.opc_op * 2 + arith.opc_flag];
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s, #0x%x%s", opcode_names[opcode], rd, rn, arith.imm12, shift);
+    return true;
+}
+
+/* Prints movn, movz and movk. */
+static bool format_wide_move(Instruction inst, uint32_t address, char *buffer) {
+    ImmWide wide = inst.imm_wide;
+    Opcode opcode = wide_move_opcodes[wide.opc];
+
+    // The assembler takes the register mode from the immediate when the destination is the zero register
+    if (opcode == NUM_OPCODES || (wide.rd == ZERO_REGISTER_INDEX && wide.sf)) {
+        return false;
+    }
+
+    char rd[REG_NAME_SIZE];
+    reg_name(rd, wide.rd, wide.sf);
+
+    if (wide.hw == 0) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, #0x%x", opcode_names[opcode], rd, wide.imm16);
+    } else {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, #0x%x, lsl #%u", opcode_names[opcode], rd, wide.imm16, wide.hw * DIV_VAL_HW);
+    }
+    return true;
+}
+
+/* Prints add, adds, sub, subs with a register, along with the cmp, cmn, neg and negs aliases. */
+static bool format_reg_arith(Instruction inst, uint32_t address, char *buffer) {
+    RegArith arith = inst.reg_arith;
+    char rd[REG_NAME_SIZE], rn[REG_NAME_SIZE], rm[REG_NAME_SIZE], shift[SHIFT_SUFFIX_SIZE];
+    reg_name(rd, arith.rd, arith.sf);
+    reg_name(rn, arith.rn, arith.sf);
+    reg_name(rm, arith.rm, arith.sf);
+    shift_suffix(shift, arith.shift, arith.operand);
+
+    if (arith.opc_flag && arith.rd == ZERO_REGISTER_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s%s", opcode_names[arith.opc_op ? OP_CMP : OP_CMN], rn, rm, shift);
+        return true;
+    }
+    if (arith.opc_op && arith.rn == ZERO_REGISTER_INDEX && arith.rd != ZERO_REGISTER_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s%s", opcode_names[arith.opc_flag ? OP_NEGS : OP_NEG], rd, rm, shift);
+        return true;
+    }
+
+    Opcode opcode = arith_opcodes[arith.opc_op * 2 + arith.opc_flag];
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s, %s%s", opcode_names[opcode], rd, rn, rm, shift);
+    return true;
+}
+
+/* Prints and, ands, bic, bics, orr, orn, eor, eon, along with the tst, mov and mvn aliases. */
+static bool format_reg_logic(Instruction inst, uint32_t address, char *buffer) {
+    RegLogic logic = inst.reg_logic;
+    char rd[REG_NAME_SIZE], rn[REG_NAME_SIZE], rm[REG_NAME_SIZE], shift[SHIFT_SUFFIX_SIZE];
+    reg_name(rd, logic.rd, logic.sf);
+    reg_name(rn, logic.rn, logic.sf);
+    reg_name(rm, logic.rm, logic.sf);
+    shift_suffix(shift, logic.shift, logic.operand);
+
+    Opcode opcode = logic_opcodes[logic.opc][logic.N];
+
+    if (opcode == OP_ANDS && logic.rd == ZERO_REGISTER_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s%s", opcode_names[OP_TST], rn, rm, shift);
+        return true;
+    }
+    // The assembler's mov and mvn take no shift
+    if ((opcode == OP_ORR || opcode == OP_ORN) && logic.rn == ZERO_REGISTER_INDEX && logic.rd != ZERO_REGISTER_INDEX && shift[0] == '\0') {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s", opcode_names[opcode == OP_ORR ? OP_MOV : OP_MVN], rd, rm);
+        return true;
+    }
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s, %s%s", opcode_names[opcode], rd, rn, rm, shift);
+    return true;
+}
+
+/* Prints madd and msub, along with the mul and mneg aliases. */
+static bool format_multiply(Instruction inst, uint32_t address, char *buffer) {
+    RegMultiply multiply = inst.reg_multiply;
+    char rd[REG_NAME_SIZE], rn[REG_NAME_SIZE], rm[REG_NAME_SIZE], ra[REG_NAME_SIZE];
+    reg_name(rd, multiply.rd, multiply.sf);
+    reg_name(rn, multiply.rn, multiply.sf);
+    reg_name(rm, multiply.rm, multiply.sf);
+    reg_name(ra, multiply.ra, multiply.sf);
+
+    if (multiply.ra == ZERO_REGISTER_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s, %s", opcode_names[multiply.x ? OP_M_NEG : OP_MUL], rd, rn, rm);
+        return true;
+    }
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s, %s, %s", opcode_names[multiply.x ? OP_M_SUB : OP_M_ADD], rd, rn, rm, ra);
+    return true;
+}
+
+/* Prints ldr of a literal, referring to the literal by label. */
+static bool format_load_literal(Instruction inst, uint32_t address, char *buffer) {
+    char rt[REG_NAME_SIZE], label[DISASSEMBLY_LINE_SIZE / 2];
+    reg_name(rt, inst.dt_load_literal.rt, inst.dt_load_literal.sf);
+    label_name(label, sizeof(label), address + sign_extend(inst.dt_load_literal.simm19, SIMM19_BITS) * INSTR_SIZE);
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, %s", opcode_names[OP_LDR], rt, label);
+    return true;
+}
+
+/* Prints ldr and str with an unsigned immediate offset. */
+static bool format_dt_imm_offset(Instruction inst, uint32_t address, char *buffer) {
+    DTImmOffset dt = inst.dt_imm_offset;
+    char rt[REG_NAME_SIZE], xn[REG_NAME_SIZE];
+    reg_name(rt, dt.rt, dt.sf);
+    reg_name(xn, dt.xn, true);
+    const char *opcode = opcode_names[dt.L ? OP_LDR : OP_STR];
+
+    // The assembler only reads "[xzr]" correctly when followed by an offset
+    if (dt.imm12 == 0 && dt.xn != ZERO_REGISTER_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, [%s]", opcode, rt, xn);
+    } else {
+        // The offset is scaled by the size of the register being transferred
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, [%s, #%u]", opcode, rt, xn, dt.imm12 * (dt.sf ? 8 : 4));
+    }
+    return true;
+}
+
+/* Prints ldr and str with a register offset. */
+static bool format_dt_reg_offset(Instruction inst, uint32_t address, char *buffer) {
+    DTRegOffset dt = inst.dt_reg_offset;
+    char rt[REG_NAME_SIZE], xn[REG_NAME_SIZE], xm[REG_NAME_SIZE];
+    reg_name(rt, dt.rt, dt.sf);
+    reg_name(xn, dt.xn, true);
+    reg_name(xm, dt.xm, true);
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, [%s, %s]", opcode_names[dt.L ? OP_LDR : OP_STR], rt, xn, xm);
+    return true;
+}
+
+/* Prints ldr and str with a pre-indexed or post-indexed offset. */
+static bool format_dt_pre_post_index(Instruction inst, uint32_t address, char *buffer) {
+    DTPrePostIndex dt = inst.dt_pre_post_index;
+    char rt[REG_NAME_SIZE], xn[REG_NAME_SIZE];
+    reg_name(rt, dt.rt, dt.sf);
+    reg_name(xn, dt.xn, true);
+    const char *opcode = opcode_names[dt.L ? OP_LDR : OP_STR];
+    int offset = sign_extend(dt.simm9, SIMM9_BITS);
+
+    if (dt.I == ITP_DT_PRE_INDEX) {
+        snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, [%s, #%d]!", opcode, rt, xn, offset);
+        return true;
+    }
+
+    // The assembler only reads "[xzr]" correctly when followed by an offset inside the brackets
+    if (dt.xn == ZERO_REGISTER_INDEX) {
+        return false;
+    }
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s, [%s], #%d", opcode, rt, xn, offset);
+    return true;
+}
+
+/* Prints b, referring to the target by label. */
+static bool format_branch_uncond(Instruction inst, uint32_t address, char *buffer) {
+    char label[DISASSEMBLY_LINE_SIZE / 2];
+    label_name(label, sizeof(label), address + sign_extend(inst.branch_unconditional.simm26, SIMM26_BITS) * INSTR_SIZE);
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s", opcode_names[OP_B], label);
+    return true;
+}
+
+/* Prints b.cond, referring to the target by label. */
+static bool format_branch_cond(Instruction inst, uint32_t address, char *buffer) {
+    Opcode condition = condition_opcodes[inst.branch_conditional.cond];
+    if (condition == NUM_OPCODES) {
+        return false;
+    }
+
+    char label[DISASSEMBLY_LINE_SIZE / 2];
+    label_name(label, sizeof(label), address + sign_extend(inst.branch_conditional.simm19, SIMM19_BITS) * INSTR_SIZE);
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s%s %s", opcode_names[OP_B_COND], opcode_names[condition], label);
+    return true;
+}
+
+/* Prints br. */
+static bool format_branch_reg(Instruction inst, uint32_t address, char *buffer) {
+    char xn[REG_NAME_SIZE];
+    reg_name(xn, inst.branch_register.xn, true);
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, "%s %s", opcode_names[OP_BR], xn);
+    return true;
+}
+
+// The fixed bits of every encoding the assembler produces, from the bit fields in instructions.h
+static const Encoding encodings[] = {
+    {0x1f800000, 0x11000000, format_imm_arith},          // op0 = 100, opi = 010
+    {0x1f800000, 0x12800000, format_wide_move},          // op0 = 100, opi = 101
+    {0x1f200000, 0x0b000000, format_reg_arith},          // M = 0, op0 = 101, id = 1, N = 0
+    {0x1f000000, 0x0a000000, format_reg_logic},          // M = 0, op0 = 101, id = 0
+    {0x7fe00000, 0x1b000000, format_multiply},           // opc = 00, M = 1, op0 = 101, id = 1, opr = 000
+    {0xbf000000, 0x18000000, format_load_literal},       // id = 0, 011000 above simm19
+    {0xbf800000, 0xb9000000, format_dt_imm_offset},      // id = 1, 11100 above U = 1
+    {0xbfa0fc00, 0xb8206800, format_dt_reg_offset},      // U = 0, id2 = 1, DT_REG_PATTERN
+    {0xbfa00400, 0xb8000400, format_dt_pre_post_index},  // U = 0, bit 21 = 0, bit 10 = 1
+    {0xfc000000, 0x14000000, format_branch_uncond},      // id = 00, op0 = 101
+    {0xff000010, 0x54000000, format_branch_cond},        // id = 01, op0 = 101
+    {0xfffffc1f, 0xd61f0000, format_branch_reg},         // id = 11, op0 = 101, BR_REG_PATTERN
+};
+
+#define NUM_ENCODINGS (sizeof(encodings) / sizeof(encodings[0]))
+
+// -----------------------------------------MAIN FUNCS:--------------------------------------
+
+/**
+ * @brief Disassembles a single word.
+ *
+ * Branches and load literals refer to their targets by the label "L<address in hex>". Words
+ * that the assembler could not have produced are printed as ".int" directives.
+ *
+ * @param word The 32-bit word to disassemble.
+ * @param address Address of the word, used to work out the targets of branches and load literals.
+ * @param buffer Buffer of DISASSEMBLY_LINE_SIZE characters to write the assembly line to.
+ */
+void disassemble_instruction(uint32_t word, uint32_t address, char *buffer) {
+    Instruction inst;
+    inst.data = word;
+
+    for (size_t i = 0; i < NUM_ENCODINGS; i++) {
+        if ((word & encodings[i].mask) == encodings[i].value && encodings[i].format(inst, address, buffer)) {
+            return;
+        }
+    }
+
+    snprintf(buffer, DISASSEMBLY_LINE_SIZE, ".int 0x%08x", word);
+}
+
+/**
+ * @brief Gets the address a branch or load literal refers to.
+ *
+ * @param word The 32-bit word to inspect.
+ * @param address Address of the word.
+ * @param target Pointer to store the address referred to (updated by reference).
+ * @return true if the word is a b, b.cond or load literal instruction, false otherwise.
+ */
+bool disassemble_target(uint32_t word, uint32_t address, uint32_t *target) {
+    Instruction inst;
+    inst.data = word;
+
+    for (size_t i = 0; i < NUM_ENCODINGS; i++) {
+        if ((word & encodings[i].mask) != encodings[i].value) {
+            continue;
+        }
+
+        if (encodings[i].format == format_branch_uncond) {
+            *target = address + sign_extend(inst.branch_unconditional.simm26, SIMM26_BITS) * INSTR_SIZE;
+            return true;
+        }
+        if (encodings[i].format == format_branch_cond && condition_opcodes[inst.branch_conditional.cond] != NUM_OPCODES) {
+            *target = address + sign_extend(inst.branch_conditional.simm19, SIMM19_BITS) * INSTR_SIZE;
+            return true;
+        }
+        if (encodings[i].format == format_load_literal) {
+            *target = address + sign_extend(inst.dt_load_literal.simm19, SIMM19_BITS) * INSTR_SIZE;
+            return true;
+        }
+        return false;
+    }
+    return false;
+}
+
+/**
+ * @brief Disassembles a whole image loaded at address 0.
+ *
+ * A first pass finds every address referred to by a branch or load literal, so that the second
+ * pass can define a label there. Instructions whose target lies outside the image are printed as
+ * ".int" directives, with the instruction in a comment, since their label could not be defined.
+ *
+ * @param words The words of the image.
+ * @param num_words Number of words in the image.
+ * @param output_file Stream to write the assembly source to.
+ * @param annotate Whether to follow every line with a comment giving its address and encoding.
+ */
+void disassemble_image(const uint32_t *words, size_t num_words, FILE *output_file, bool annotate) {
+    bool *is_target = calloc(num_words + 1, sizeof(bool));
+    assert_msg(is_target != NULL, "Memory allocation failed\n");
+
+    uint32_t image_size = num_words * INSTR_SIZE;
+    uint32_t target;
+
+    for (size_t i = 0; i < num_words; i++) {
+        if (disassemble_target(words[i], i * INSTR_SIZE, &target) && target <= image_size) {
+            is_target[target / INSTR_SIZE] = true;
+        }
+    }
+
+    char line[DISASSEMBLY_LINE_SIZE];
+    char label[DISASSEMBLY_LINE_SIZE / 2];
+
+    for (size_t i = 0; i <= num_words; i++) {
+        uint32_t address = i * INSTR_SIZE;
+
+        if (is_target[i]) {
+            label_name(label, sizeof(label), address);
+            fprintf(output_file, "%s:\n", label);
+        }
+        if (i == num_words) {
+            break;
+        }
+
+        disassemble_instruction(words[i], address, line);
+
+        if (disassemble_target(words[i], address, &target) && target > image_size) {
+            fprintf(output_file, ".int 0x%08x // %s", words[i], line);
+        } else {
+            fputs(line, output_file);
+        }
+
+        if (annotate) {
+            fprintf(output_file, " // 0x%08x: %08x", address, words[i]);
+        }
+        fputc('\n', output_file);
+    }
+
+    free(is_target);
+}
@@ -0,0 +1,30 @@
+/**
+ * @file disassembler.h
+ * @brief Header file for turning 32-bit machine code back into assembly source.
+ *
+ * The disassembler recognises exactly the encodings the assembler produces and prints them in
+ * the syntax the assembler reads, so that disassembling an image and assembling the result gives
+ * back the same image. Words that are not such an encoding are printed as ".int" directives.
+ */
+
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Enough room for the longest line the disassembler produces
+#define DISASSEMBLY_LINE_SIZE 64
+
+// Disassemble a single word located at the given address into a buffer of DISASSEMBLY_LINE_SIZE characters.
+extern void disassemble_instruction(uint32_t word, uint32_t address, char *buffer);
+
+// Get the address a branch or load literal refers to, returning false for any other instruction.
+extern bool disassemble_target(uint32_t word, uint32_t address, uint32_t *target);
+
+// Disassemble a whole image loaded at address 0, defining a label at every address referred to.
+extern void disassemble_image(const uint32_t *words, size_t num_words, FILE *output_file, bool annotate);
+
+#endif /* DISASSEMBLER_H */
@@ -0,0 +1,107 @@
+/**
+ * @file link.c
+ * @brief Static linker combining relocatable object files into a single flat binary image.
+ *
+ * Objects are placed one after another in the order given on the command line. Every
+ * relocation is first recorded in the symbol table as a use of its label at the relocated
+ * address, then every symbol that some relocation uses is defined at its relocated address,
+ * which patches all uses of it (and catches such labels defined in more than one object).
+ * Anything left unresolved is reported as an undefined reference.
+ *
+ * Uses of a label within its own object were already patched by the assembler, so a symbol
+ * no other object uses stays local: several objects may each define their own `loop:`.
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "../utils.h"
+#include "../ADTs/darray.h"
+#include "../ADTs/hashmap.h"
+#include "symbol_table.h"
+#include "object.h"
+
+#define INSTR_SIZE 4
+
+static bool has_undefined_reference; // Set once any relocation cannot be resolved
+
+/**
+ * @brief Reports a use of a label that no object defines, as a symbol_table_for_each_unresolved call back.
+ */
+static void report_undefined_reference(const char *label, uint32_t address, void *state) {
+    fprintf(stderr, "Undefined reference to %s at address %x\n", label, address);
+    has_undefined_reference = true;
+}
+
+/**
+ * Main function for the linker.
+ *
+ * Reads each object file, concatenates their instructions, resolves every relocation against
+ * the symbols of all the objects and writes the result out as a flat binary image.
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line argument strings containing the output file path followed by the object file paths.
+ * @return EXIT_SUCCESS if every reference was resolved, otherwise EXIT_FAILURE.
+ */
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: ./link output-file object-file...\n");
+        return EXIT_FAILURE;
+    }
+
+    int num_objects = argc - 2;
+    ObjectFile **objects = malloc(num_objects * sizeof(ObjectFile *));
+    uint32_t *bases = malloc(num_objects * sizeof(uint32_t));
+    assert_msg(objects != NULL && bases != NULL, "Memory allocation failed\n");
+
+    DArray *instructions = darray_init(NULL);
+
+    // Lay the objects out one after another
+    for (int i = 0; i < num_objects; i++) {
+        objects[i] = object_read(argv[i + 2]);
+        bases[i] = darray_length(instructions) * INSTR_SIZE;
+
+        for (int j = 0; j < darray_length(objects[i]->instructions); j++) {
+            darray_add(instructions, darray_get(objects[i]->instructions, j));
+        }
+    }
+
+    symbol_table_init();
+    HashMap *referenced = hashmap_init(NULL);
+
+    // Record every relocation before defining any label, so that each one is patched when its label is added
+    for (int i = 0; i < num_objects; i++) {
+        for (int j = 0; j < darray_length(objects[i]->relocations); j++) {
+            ObjectEntry *relocation = darray_get(objects[i]->relocations, j);
+            symbol_table_get_address(bases[i] + relocation->address, relocation->label);
+            hashmap_set(referenced, relocation->label, NULL);
+        }
+    }
+
+    // Only labels used by another object are global, the rest were resolved within their own object
+    for (int i = 0; i < num_objects; i++) {
+        for (int j = 0; j < darray_length(objects[i]->symbols); j++) {
+            ObjectEntry *symbol = darray_get(objects[i]->symbols, j);
+            if (hashmap_contains(referenced, symbol->label)) {
+                symbol_table_add_label(instructions, bases[i] + symbol->address, symbol->label);
+            }
+        }
+    }
+
+    symbol_table_for_each_unresolved(report_undefined_reference, NULL);
+
+    if (!has_undefined_reference) {
+        write_image(argv[1], instructions);
+    }
+
+    hashmap_free(referenced);
+    symbol_table_free();
+    darray_free(instructions);
+    for (int i = 0; i < num_objects; i++) {
+        object_free(objects[i]);
+    }
+    free(objects);
+    free(bases);
+
+    return has_undefined_reference ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,322 @@
+/**
+ * @file object.c
+ * @brief Implementation file for relocatable object files and flat binary images.
+ *
+ * This file defines functions for building, writing, reading and freeing relocatable object
+ * files, as well as writing a plain array of instructions out as a flat binary image.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "object.h"
+#include "../utils.h"
+
+// Size of an instruction in bytes
+#define INSTR_SIZE 4
+
+// Number of uint32_t fields in the object file header
+#define HEADER_SIZE 5
+
+typedef enum {HEADER_MAGIC, HEADER_VERSION, HEADER_NUM_WORDS, HEADER_NUM_SYMBOLS, HEADER_NUM_RELOCATIONS} HeaderField;
+
+/**
+ * @brief Frees an object entry along with its label.
+ * @param entry Entry to free.
+ */
+static void free_entry(void *entry) {
+    ObjectEntry *object_entry = entry;
+    free(object_entry->label);
+    free(object_entry);
+}
+
+/**
+ * @brief Initializes an empty object file.
+ * @return Pointer to the new object file.
+ */
+ObjectFile *object_init(void) {
+    ObjectFile *object = malloc(sizeof(ObjectFile));
+    assert_msg(object != NULL, "Memory allocation failed\n");
+
+    object->instructions = darray_init(free);
+    object->symbols      = darray_init(free_entry);
+    object->relocations  = darray_init(free_entry);
+
+    return object;
+}
+
+/**
+ * @brief Copies the assembled words of an array of instructions into the object.
+ * @param object Object to add the words to.
+ * @param instructions Array of instructions (uint32_t *) to copy.
+ */
+void object_add_instructions(ObjectFile *object, DArray *instructions) {
+    for (int i = 0; i < darray_length(instructions); i++) {
+        uint32_t *word = malloc(sizeof(uint32_t));
+        assert_msg(word != NULL, "Memory allocation failed\n");
+        *word = *(uint32_t *) darray_get(instructions, i);
+        darray_add(object->instructions, word);
+    }
+}
+
+/**
+ * @brief Creates an entry with a copy of the label and adds it to an array of entries.
+ * @param entries Array of entries to add to.
+ * @param label Label of the entry.
+ * @param address Address of the entry.
+ */
+static void add_entry(DArray *entries, const char *label, uint32_t address) {
+    ObjectEntry *entry = malloc(sizeof(ObjectEntry));
+    assert_msg(entry != NULL, "Memory allocation failed\n");
+
+    entry->label = strdup(label);
+    assert_msg(entry->label != NULL, "Memory allocation failed\n");
+    entry->address = address;
+
+    darray_add(entries, entry);
+}
+
+/**
+ * @brief Adds a label defined at the given address within the object.
+ * @param object Object to add the symbol to.
+ * @param label Label being defined.
+ * @param address Address of the label.
+ */
+void object_add_symbol(ObjectFile *object, const char *label, uint32_t address) {
+    add_entry(object->symbols, label, address);
+}
+
+/**
+ * @brief Adds a use of a label that is not defined within the object.
+ * @param object Object to add the relocation to.
+ * @param label Label being used.
+ * @param address Address of the instruction using the label.
+ */
+void object_add_relocation(ObjectFile *object, const char *label, uint32_t address) {
+    add_entry(object->relocations, label, address);
+}
+
+/**
+ * @brief Writes a single uint32_t to a file in little endian byte order, exiting on failure.
+ * @param value Value to write.
+ * @param output_file File to write to.
+ * @param output_file_path Path of the file, for error messages.
+ */
+static void write_uint32(uint32_t value, FILE *output_file, const char *output_file_path) {
+    uint8_t bytes[sizeof(uint32_t)];
+    for (size_t i = 0; i < sizeof(uint32_t); i++) {
+        bytes[i] = (value >> (8 * i)) & 0xff;
+    }
+    assert_msg(fwrite(bytes, 1, sizeof(uint32_t), output_file) == sizeof(uint32_t), "Failed to write to file %s\n", output_file_path);
+}
+
+/**
+ * @brief Writes each entry in an array as its address, label length and label characters.
+ * @param entries Array of entries to write.
+ * @param output_file File to write to.
+ * @param output_file_path Path of the file, for error messages.
+ */
+static void write_entries(DArray *entries, FILE *output_file, const char *output_file_path) {
+    for (int i = 0; i < darray_length(entries); i++) {
+        ObjectEntry *entry = darray_get(entries, i);
+        uint32_t label_length = strlen(entry->label);
+
+        write_uint32(entry->address, output_file, output_file_path);
+        write_uint32(label_length, output_file, output_file_path);
+        assert_msg(fwrite(entry->label, 1, label_length, output_file) == label_length, "Failed to write to file %s\n", output_file_path);
+    }
+}
+
+/**
+ * @brief Writes the object to a file in the layout described in object.h.
+ *
+ * @param object Object to write.
+ * @param output_file_path Path to the output object file.
+ *
+ * @note The function exits the program with a failure status if the file cannot be written.
+ */
+void object_write(const ObjectFile *object, const char *output_file_path) {
+    FILE *output_file = fopen(output_file_path, "wb");
+    if (output_file == NULL) {
+        fprintf(stderr, "Failed to open file %s\n", output_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t header[HEADER_SIZE] = {
+        [HEADER_MAGIC]           = OBJECT_MAGIC,
+        [HEADER_VERSION]         = OBJECT_VERSION,
+        [HEADER_NUM_WORDS]       = darray_length(object->instructions),
+        [HEADER_NUM_SYMBOLS]     = darray_length(object->symbols),
+        [HEADER_NUM_RELOCATIONS] = darray_length(object->relocations),
+    };
+    for (int i = 0; i < HEADER_SIZE; i++) {
+        write_uint32(header[i], output_file, output_file_path);
+    }
+
+    for (int i = 0; i < darray_length(object->instructions); i++) {
+        write_uint32(*(uint32_t *) darray_get(object->instructions, i), output_file, output_file_path);
+    }
+
+    write_entries(object->symbols, output_file, output_file_path);
+    write_entries(object->relocations, output_file, output_file_path);
+
+    fclose(output_file);
+}
+
+/**
+ * @brief Reads a single uint32_t stored in little endian byte order from a file, exiting on failure.
+ * @param input_file File to read from.
+ * @param input_file_path Path of the file, for error messages.
+ * @return The value read.
+ */
+static uint32_t read_uint32(FILE *input_file, const char *input_file_path) {
+    uint8_t bytes[sizeof(uint32_t)];
+    if (fread(bytes, 1, sizeof(uint32_t), input_file) != sizeof(uint32_t)) {
+        fprintf(stderr, "Object file %s is truncated\n", input_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t value = 0;
+    for (size_t i = 0; i < sizeof(uint32_t); i++) {
+        value |= (uint32_t) bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/**
+ * @brief Gets the number of bytes left to read in a file.
+ * @param input_file File being read.
+ * @return The number of bytes between the current position and the end of the file.
+ */
+static long remaining_size(FILE *input_file) {
+    long position = ftell(input_file);
+    fseek(input_file, 0, SEEK_END);
+    long end = ftell(input_file);
+    fseek(input_file, position, SEEK_SET);
+    return end - position;
+}
+
+/**
+ * @brief Reads a number of entries from a file into an array of entries.
+ * @param entries Array to add the entries to.
+ * @param num_entries Number of entries to read.
+ * @param max_address Largest address an entry may have.
+ * @param input_file File to read from.
+ * @param input_file_path Path of the file, for error messages.
+ */
+static void read_entries(DArray *entries, uint32_t num_entries, int64_t max_address, FILE *input_file, const char *input_file_path) {
+    for (uint32_t i = 0; i < num_entries; i++) {
+        uint32_t address = read_uint32(input_file, input_file_path);
+        uint32_t label_length = read_uint32(input_file, input_file_path);
+
+        // The linker indexes the instructions with the address, so it must be one of theirs
+        if (address % INSTR_SIZE != 0 || (int64_t) address > max_address) {
+            fprintf(stderr, "Object file %s has an entry at invalid address %x\n", input_file_path, address);
+            exit(EXIT_FAILURE);
+        }
+
+        // A length read from the file cannot be trusted to allocate with until it is known to fit in the file
+        if (label_length > remaining_size(input_file)) {
+            fprintf(stderr, "Object file %s is truncated\n", input_file_path);
+            exit(EXIT_FAILURE);
+        }
+
+        char *label = malloc(label_length + 1);
+        assert_msg(label != NULL, "Memory allocation failed\n");
+        if (fread(label, 1, label_length, input_file) != label_length) {
+            fprintf(stderr, "Object file %s is truncated\n", input_file_path);
+            exit(EXIT_FAILURE);
+        }
+        label[label_length] = '\0';
+
+        add_entry(entries, label, address);
+        free(label);
+    }
+}
+
+/**
+ * @brief Reads an object back from a file written by object_write.
+ *
+ * @param input_file_path Path to the input object file.
+ * @return Pointer to the object read.
+ *
+ * @note The function exits the program with a failure status if the file cannot be opened,
+ *       is not an object file of a supported version, is truncated, or has a symbol or
+ *       relocation at an address outside its instructions.
+ */
+ObjectFile *object_read(const char *input_file_path) {
+    FILE *input_file = fopen(input_file_path, "rb");
+    if (input_file == NULL) {
+        fprintf(stderr, "Failed to open file %s\n", input_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    uint32_t header[HEADER_SIZE];
+    for (int i = 0; i < HEADER_SIZE; i++) {
+        header[i] = read_uint32(input_file, input_file_path);
+    }
+
+    if (header[HEADER_MAGIC] != OBJECT_MAGIC || header[HEADER_VERSION] != OBJECT_VERSION) {
+        fprintf(stderr, "File %s is not a supported object file\n", input_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    ObjectFile *object = object_init();
+
+    for (uint32_t i = 0; i < header[HEADER_NUM_WORDS]; i++) {
+        uint32_t *word = malloc(sizeof(uint32_t));
+        assert_msg(word != NULL, "Memory allocation failed\n");
+        *word = read_uint32(input_file, input_file_path);
+        darray_add(object->instructions, word);
+    }
+
+    // A label may come after the last instruction, but a relocation must patch one of them
+    int64_t end_address = (int64_t) header[HEADER_NUM_WORDS] * INSTR_SIZE;
+    read_entries(object->symbols, header[HEADER_NUM_SYMBOLS], end_address, input_file, input_file_path);
+    read_entries(object->relocations, header[HEADER_NUM_RELOCATIONS], end_address - INSTR_SIZE, input_file, input_file_path);
+
+    fclose(input_file);
+    return object;
+}
+
+/**
+ * @brief Frees the object along with its instructions, symbols and relocations.
+ * @param object Object to free.
+ */
+void object_free(ObjectFile *object) {
+    darray_free(object->instructions);
+    darray_free(object->symbols);
+    darray_free(object->relocations);
+    free(object);
+}
+
+/**
+ * @brief Writes an array of instructions to a binary file.
+ *
+ * This function opens a binary file specified by `output_file_path` in write mode ("wb").
+ * It then iterates through the provided dynamic array `instructions`, writing each uint32_t
+ * element to the file. If any errors occur during file operations, such as failure to open
+ * or write to the file, the function prints an error message to stderr and exits the program.
+ *
+ * @param output_file_path Path to the output binary file.
+ * @param instructions Dynamic array (DArray) containing uint32_t instructions to write.
+ */
+void write_image(const char *output_file_path, DArray *instructions) {
+    FILE *output_file = fopen(output_file_path, "wb");
+    if (output_file == NULL) {
+        fprintf(stderr, "Failed to open file %s\n", output_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    assert_msg(instructions != NULL, "Instructions DArray passed in is empty\n");
+
+    int index = 0;
+    uint32_t *pbinary;
+
+    while (darray_iterator(instructions, &index, (void **) &pbinary)) {
+        assert_msg(fwrite(pbinary, sizeof(uint32_t), 1, output_file) == 1, "Failed to write to file %s\n", output_file_path);
+    }
+
+    fclose(output_file);
+}
@@ -0,0 +1,65 @@
+/**
+ * @file object.h
+ * @brief Header file for relocatable object files and flat binary images.
+ *
+ * A relocatable object holds the assembled instructions of one source file along with
+ * the labels it defines (symbols) and the labels it uses but does not define (relocations).
+ * Uses of a label defined in the same file are patched before the object is written, so the
+ * linker only needs a symbol to resolve another object's relocation; every other symbol is local.
+ * The linker concatenates objects and patches each relocation once every symbol is known.
+ *
+ * Layout of an object file (all fields are uint32_t, stored little endian whatever the host):
+ * - Header: magic, version, number of words, number of symbols, number of relocations.
+ * - The assembled words.
+ * - Each symbol then each relocation: address, label length, followed by the label characters.
+ *
+ * A symbol's address is the address of the label within the object. A relocation's address
+ * is the address of the instruction whose simm26 or simm19 field refers to the label.
+ */
+
+#ifndef OBJECT_H
+#define OBJECT_H
+
+#include <stdint.h>
+#include "../ADTs/darray.h"
+
+#define OBJECT_MAGIC 0x4a424f41 // "AOBJ"
+#define OBJECT_VERSION 1
+
+// A label together with an address, used for both symbols and relocations
+typedef struct {
+    char *label;
+    uint32_t address;
+} ObjectEntry;
+
+typedef struct {
+    DArray *instructions;  // Assembled words (uint32_t *)
+    DArray *symbols;       // Labels defined in the object (ObjectEntry *)
+    DArray *relocations;   // Uses of labels not defined in the object (ObjectEntry *)
+} ObjectFile;
+
+// Initialize an empty object file.
+extern ObjectFile *object_init(void);
+
+// Copy the assembled words of an array of instructions into the object.
+extern void object_add_instructions(ObjectFile *object, DArray *instructions);
+
+// Add a label defined at the given address.
+extern void object_add_symbol(ObjectFile *object, const char *label, uint32_t address);
+
+// Add a use of an undefined label by the instruction at the given address.
+extern void object_add_relocation(ObjectFile *object, const char *label, uint32_t address);
+
+// Write the object to a file.
+extern void object_write(const ObjectFile *object, const char *output_file_path);
+
+// Read an object back from a file.
+extern ObjectFile *object_read(const char *input_file_path);
+
+// Free the object and everything in it.
+extern void object_free(ObjectFile *object);
+
+// Write an array of instructions to a flat binary image.
+extern void write_image(const char *output_file_path, DArray *instructions);
+
+#endif /* OBJECT_H */
@@ -9,13 +9,15 @@
 
 #include "symbol_table.h"
 #include "../utils.h"
+#include "../fault.h"
 #include "../ADTs/hashmap.h"
 #include "../instructions.h"
 
 #define INSTR_SIZE 4
 
-static HashMap *labels;     // HashMap to store labels and their corresponding literal addresses
-static HashMap *addresses;  // HashMap to store labels and lists of addresses where they are used
+// Each thread gets its own symbol table so that chunks of a file can be assembled in parallel
+static _Thread_local HashMap *labels;     // HashMap to store labels and their corresponding literal addresses
+static _Thread_local HashMap *addresses;  // HashMap to store labels and lists of addresses where they are used
 
 /**
  * @brief Initializes the symbol tables for labels and addresses.
@@ -69,8 +71,7 @@ static void modify_line(uint32_t *instruction, uint32_t instruction_address, uin
 
     // Print the instruction bits and exit on failure if the instruction shouldn't have a branch literal
     print_bits(*instruction);
-    fprintf(stderr, "Instruction passed in is not meant to have a branch literal: %x\n", *instruction);
-    exit(EXIT_FAILURE);
+    fault_raise("Instruction passed in is not meant to have a branch literal: %x\n", *instruction);
 }
 
 /**
@@ -85,12 +86,10 @@ static void modify_line(uint32_t *instruction, uint32_t instruction_address, uin
  */
 void symbol_table_add_label(DArray *instructions, uint32_t literal_address, char *label) {
     // Ensure the label is not already defined:
-    assert_msg(
-        !hashmap_contains(labels, label), 
-        "Multiple definitions of label in address %x and %x\n", 
-        *(uint32_t *) hashmap_get(labels, label),
-        literal_address
-    );
+    if (hashmap_contains(labels, label)) {
+        fault_raise("Multiple definitions of label in address %x and %x\n",
+                    *(uint32_t *) hashmap_get(labels, label), literal_address);
+    }
 
     // Store the literal address in `labels`:
     uint32_t *address_copy = malloc(sizeof(uint32_t));
@@ -150,6 +149,118 @@ int symbol_table_get_address(uint32_t instruction_address, char *label) {
     return 0;
 }
 
+/**
+ * @brief Hands over the lists of addresses where labels are used, leaving an empty list behind.
+ * 
+ * Used by threads that assemble part of a file to pass their unresolved references on to the
+ * thread that does the final fixup pass. The caller takes ownership of the returned HashMap.
+ * 
+ * @return HashMap mapping label strings to lists of addresses (DArray *) where they are used.
+ */
+HashMap *symbol_table_release_references(void) {
+    HashMap *references = addresses;
+    addresses = hashmap_init(darray_free);
+    return references;
+}
+
+/**
+ * @brief Resolves every reference to one label, as a hashmap_for_each call back.
+ * 
+ * References to labels this symbol table knows are patched straight away, while the rest
+ * are recorded in `addresses` exactly as if symbol_table_get_address had seen them.
+ * 
+ * @param label Label string the references are to.
+ * @param value List of addresses (DArray *) of instructions referencing the label.
+ * @param state Array of instructions (DArray *) to modify.
+ */
+static void resolve_label_references(const char *label, void *value, void *state) {
+    DArray *addresses_of_instructions = value;
+    DArray *instructions = state;
+
+    int i = 0;
+    uint32_t *instruction_address;
+    while (darray_iterator(addresses_of_instructions, &i, (void **) &instruction_address)) {
+        if (!hashmap_contains(labels, label)) {
+            symbol_table_get_address(*instruction_address, (char *) label);
+            continue;
+        }
+
+        uint32_t *instruction = darray_get(instructions, (*instruction_address) / INSTR_SIZE);
+        modify_line(instruction, *instruction_address, *(uint32_t *) hashmap_get(labels, label));
+    }
+}
+
+/**
+ * @brief Resolves references recorded by another symbol table against the labels in this one.
+ * 
+ * This is the fixup pass of parallel assembly: the worker threads record every label they use
+ * in their own `addresses`, and the labels are then resolved here once all of them are known.
+ * 
+ * @param instructions Array of instructions the references point into.
+ * @param references HashMap from labels to lists of addresses, as returned by symbol_table_release_references.
+ */
+void symbol_table_resolve_references(DArray *instructions, HashMap *references) {
+    hashmap_for_each(references, resolve_label_references, instructions);
+}
+
+/**
+ * @brief State threaded through the hashmap_for_each call backs of the enumerators below.
+ */
+typedef struct {
+    void (*call_back)(const char *label, uint32_t address, void *state);
+    void *state;
+} EnumerateState;
+
+/**
+ * @brief Passes a single label and its literal address on, as a hashmap_for_each call back.
+ */
+static void enumerate_label(const char *label, void *value, void *state) {
+    EnumerateState *enumerate = state;
+    enumerate->call_back(label, *(uint32_t *) value, enumerate->state);
+}
+
+/**
+ * @brief Passes on every use of a label that was never defined, as a hashmap_for_each call back.
+ */
+static void enumerate_unresolved(const char *label, void *value, void *state) {
+    // References to defined labels were already patched by symbol_table_add_label
+    if (hashmap_contains(labels, label)) {
+        return;
+    }
+
+    EnumerateState *enumerate = state;
+    int i = 0;
+    uint32_t *instruction_address;
+    while (darray_iterator(value, &i, (void **) &instruction_address)) {
+        enumerate->call_back(label, *instruction_address, enumerate->state);
+    }
+}
+
+/**
+ * @brief Calls a function on every label defined so far along with its literal address.
+ * 
+ * @param call_back Function to call on each label.
+ * @param state Extra argument passed to every call.
+ */
+void symbol_table_for_each_label(void (*call_back)(const char *label, uint32_t address, void *state), void *state) {
+    EnumerateState enumerate = {call_back, state};
+    hashmap_for_each(labels, enumerate_label, &enumerate);
+}
+
+/**
+ * @brief Calls a function on every use of a label that has not been defined.
+ * 
+ * Once a whole file has been decoded these are exactly the references that need to be
+ * resolved by the linker against labels in other files.
+ * 
+ * @param call_back Function to call with the label and the address of the instruction using it.
+ * @param state Extra argument passed to every call.
+ */
+void symbol_table_for_each_unresolved(void (*call_back)(const char *label, uint32_t address, void *state), void *state) {
+    EnumerateState enumerate = {call_back, state};
+    hashmap_for_each(addresses, enumerate_unresolved, &enumerate);
+}
+
 /**
  * @brief Frees the memory allocated for symbol tables (`labels` and `addresses`).
  * 
@@ -13,6 +13,7 @@
 
 #include <stdint.h>
 #include "../ADTs/darray.h"
+#include "../ADTs/hashmap.h"
 
 // Initialize the symbol table.
 extern void symbol_table_init();
@@ -23,6 +24,18 @@ extern void symbol_table_add_label(DArray *instructions, uint32_t address, char
 // Get the offset from a label to an instruction.
 extern int symbol_table_get_address(uint32_t address_of_instruction, char *label);
 
+// Hand over the lists of addresses where labels are used, leaving an empty list behind.
+extern HashMap *symbol_table_release_references(void);
+
+// Patch references recorded by another symbol table using the labels in this one.
+extern void symbol_table_resolve_references(DArray *instructions, HashMap *references);
+
+// Call a function on every label defined so far along with its address.
+extern void symbol_table_for_each_label(void (*call_back)(const char *label, uint32_t address, void *state), void *state);
+
+// Call a function on every use of a label that has not been defined.
+extern void symbol_table_for_each_unresolved(void (*call_back)(const char *label, uint32_t address, void *state), void *state);
+
 // Free the memory allocated for the symbol table.
 extern void symbol_table_free();
 
@@ -1 +1,3 @@
-extern void assemble(const char *input_file_path, const char *output_file_path);
\ No newline at end of file
+#include <stdbool.h>
+
+extern void assemble(const char *input_file_path, const char *output_file_path, bool relocatable);
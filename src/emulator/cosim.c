@@ -0,0 +1,189 @@
+/**
+ * @file cosim.c
+ * @brief Differential co-simulation of an execution engine against the reference.
+ *
+ * Starting from a saved state, the engine under test runs for a stretch of about `interval`
+ * instructions (it may run on to the end of a basic block). The state is then restored and the
+ * reference, step_instruction, executes exactly as many instructions. If the two resulting states
+ * differ, the stretch is replayed one basic block at a time (the smallest unit an engine can be
+ * stopped at) to find the first block that goes wrong, which is reported together with every
+ * register, flag and memory word that differs.
+ *
+ * Memory mapped devices see every access twice, so co-simulation should be run without them.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cosim.h"
+#include "cpu.h"
+#include "../utils.h"
+
+// States used by a co-simulation, kept in static storage since each holds a copy of memory
+static CpuSnapshot start_state;       // State at the start of the current stretch
+static CpuSnapshot engine_state;      // State after the engine ran the stretch
+static CpuSnapshot reference_state;   // State after the reference ran the stretch
+
+/**
+ * @brief Checks whether either of two states may have a non-zero byte in a page of memory.
+ *
+ * A page written by neither is zero in both, so only the written pages need comparing.
+ */
+static bool page_written(const CpuSnapshot *a, const CpuSnapshot *b, int page) {
+    return a->written_pages[page] || b->written_pages[page];
+}
+
+/**
+ * @brief Checks whether two states differ in any register, flag, memory word or instruction count.
+ */
+static bool states_differ(const CpuSnapshot *a, const CpuSnapshot *b) {
+    if (memcmp(a->registers, b->registers, sizeof(a->registers)) != 0
+        || a->program_counter != b->program_counter
+        || memcmp(&a->pstate, &b->pstate, sizeof(a->pstate)) != 0
+        || a->instruction_count != b->instruction_count) {
+        return true;
+    }
+    for (int page = 0; page < NUM_MEMORY_PAGES; page++) {
+        size_t offset = (size_t) page * MEMORY_PAGE_SIZE;
+        if (page_written(a, b, page) && memcmp(a->memory + offset, b->memory + offset, MEMORY_PAGE_SIZE) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Writes out every register, flag and memory word that differs between the engine and the reference.
+ */
+static void report_differences(const CpuSnapshot *engine, const CpuSnapshot *reference, FILE *report_file) {
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        if (engine->registers[i] != reference->registers[i]) {
+            fprintf(report_file, "  X%02d: engine %016lx, reference %016lx\n", i, engine->registers[i], reference->registers[i]);
+        }
+    }
+    if (engine->program_counter != reference->program_counter) {
+        fprintf(report_file, "  PC: engine %016lx, reference %016lx\n", engine->program_counter, reference->program_counter);
+    }
+
+    const processor_state *e = &engine->pstate, *r = &reference->pstate;
+    if (memcmp(e, r, sizeof(processor_state)) != 0) {
+        fprintf(report_file, "  PSTATE: engine %s%s%s%s, reference %s%s%s%s\n",
+                e->negative_flag ? "N" : "-", e->zero_flag ? "Z" : "-", e->carry_flag ? "C" : "-", e->overflow_flag ? "V" : "-",
+                r->negative_flag ? "N" : "-", r->zero_flag ? "Z" : "-", r->carry_flag ? "C" : "-", r->overflow_flag ? "V" : "-");
+    }
+
+    if (engine->instruction_count != reference->instruction_count) {
+        fprintf(report_file, "  Instructions run: engine %lu, reference %lu (the reference halted first)\n",
+                engine->instruction_count, reference->instruction_count);
+    }
+
+    for (uint32_t address = 0; address < NUM_OF_MEMORY_ADDRESS; address += sizeof(word)) {
+        if (!page_written(engine, reference, address / MEMORY_PAGE_SIZE)) {
+            address += MEMORY_PAGE_SIZE - sizeof(word);
+            continue;
+        }
+        word engine_word, reference_word;
+        memcpy(&engine_word, engine->memory + address, sizeof(word));
+        memcpy(&reference_word, reference->memory + address, sizeof(word));
+        if (engine_word != reference_word) {
+            fprintf(report_file, "  0x%08x: engine %08x, reference %08x\n", address, engine_word, reference_word);
+        }
+    }
+}
+
+/**
+ * @brief Runs the engine and then the reference over the same stretch from the current state.
+ *
+ * On return the CPU holds the reference's state, and engine_state and reference_state hold the
+ * states each reached. If the reference halts before it has run as many instructions as the
+ * engine, it stops there, and the instruction counts of the two states differ.
+ *
+ * The snapshots only copy the pages of memory that have been written (see memory_snapshot), so a
+ * stretch costs in proportion to the memory the program has touched rather than all of memory.
+ *
+ * @param engine Engine under test.
+ * @param limit Instruction count at which the engine should stop.
+ * @return true if the engine halted within the stretch.
+ */
+static bool run_stretch(Engine engine, uint64_t limit) {
+    cpu_snapshot(&start_state);
+
+    set_instruction_limit(limit);
+    bool halted = engine();
+    cpu_snapshot(&engine_state);
+
+    cpu_restore(&start_state);
+    while (get_instruction_count() < engine_state.instruction_count) {
+        if (!step_instruction()) {
+            break;  // The reference halted first, which states_differ sees in the instruction counts
+        }
+    }
+    cpu_snapshot(&reference_state);
+
+    return halted;
+}
+
+/**
+ * @brief Replays a stretch that diverged one basic block at a time, reporting the first block that goes wrong.
+ *
+ * @param engine Engine under test.
+ * @param report_file Stream to write the report to.
+ */
+static void find_divergence(Engine engine, FILE *report_file) {
+    while (true) {
+        uint64_t block_start = get_instruction_count();
+        uint64_t block_pc = get_spec_register(PROGRAM_COUNTER);
+        bool halted = run_stretch(engine, block_start + 1);
+
+        if (states_differ(&engine_state, &reference_state)) {
+            uint64_t block_length = engine_state.instruction_count - block_start;
+            fprintf(report_file, "Engines diverged in the %lu instruction%s from instruction %lu at 0x%lx:\n",
+                    block_length, block_length == 1 ? "" : "s", block_start, block_pc);
+            for (uint64_t i = 0; i < block_length && block_pc + i * INSTR_SIZE < NUM_OF_MEMORY_ADDRESS; i++) {
+                uint32_t address = block_pc + i * INSTR_SIZE;
+                word instruction;
+                memcpy(&instruction, start_state.memory + address, sizeof(word));
+                fprintf(report_file, "  0x%08x: %08x\n", address, instruction);
+            }
+            fprintf(report_file, "Differences after the block:\n");
+            report_differences(&engine_state, &reference_state, report_file);
+            return;
+        }
+        if (halted) {
+            fprintf(report_file, "Engines diverged, but the divergence did not happen again when replayed\n");
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Runs the program loaded into the CPU with an engine and the reference in lockstep.
+ *
+ * @param engine Engine under test, such as run_cpu.
+ * @param interval Number of instructions between comparisons. Smaller intervals find a
+ *                 divergence sooner but copy memory more often.
+ * @param max_instructions Stop once this many instructions have run, or UINT64_MAX for no limit.
+ * @param report_file Stream to report the first divergence to.
+ * @return How the co-simulation ended. The CPU is left in the reference's state.
+ */
+CosimResult cosim_run(Engine engine, uint64_t interval, uint64_t max_instructions, FILE *report_file) {
+    assert_msg(interval > 0, "Co-simulation interval must be positive\n");
+
+    while (true) {
+        uint64_t count = get_instruction_count();
+        uint64_t limit = max_instructions - count < interval ? max_instructions : count + interval;
+        bool halted = run_stretch(engine, limit);
+
+        if (states_differ(&engine_state, &reference_state)) {
+            cpu_restore(&start_state);
+            find_divergence(engine, report_file);
+            return COSIM_DIVERGED;
+        }
+        if (halted) {
+            return COSIM_HALTED;
+        }
+        if (get_instruction_count() >= max_instructions || cpu_stop_requested()) {
+            return COSIM_STOPPED;
+        }
+    }
+}
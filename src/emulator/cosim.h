@@ -0,0 +1,30 @@
+/**
+ * @file cosim.h
+ * @brief Header file for differential co-simulation of an execution engine against the reference.
+ *
+ * The reference engine executes one instruction at a time with step_instruction. Any other engine
+ * (such as run_cpu) is run in lockstep with it: both run the same stretch of instructions from the
+ * same state, and their registers, flags and memory are compared after every stretch.
+ */
+
+#ifndef COSIM_H
+#define COSIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// An engine under test, which runs until the CPU halts or the instruction limit is reached (like run_cpu)
+typedef bool (*Engine)(void);
+
+// How a co-simulation ended
+typedef enum {
+    COSIM_HALTED,     // Both engines ran to the halt instruction and agreed throughout
+    COSIM_STOPPED,    // The instruction limit or stop_cpu ended the run first, with the engines agreeing so far
+    COSIM_DIVERGED    // The engines disagreed; the first mismatch has been reported
+} CosimResult;
+
+// Runs the CPU's program with an engine and the reference in lockstep, comparing them every interval instructions.
+extern CosimResult cosim_run(Engine engine, uint64_t interval, uint64_t max_instructions, FILE *report_file);
+
+#endif /* COSIM_H */
@@ -8,50 +8,104 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <signal.h>
+#include <unistd.h>
 
 #include "register.h"
 #include "memory.h"
 #include "cpu.h"
+#include "timing.h"
 #include "../utils.h"
+#include "../fault.h"
 #include "../debugging.h"
 
-#define DEBUGGING_MODE false
-
+// The state below belongs to one core, so each host thread has its own (see smp.h)
 //Declare processor state variables:
-processor_state pstate = {false, true, false, false};
+CORE_LOCAL processor_state pstate = {false, true, false, false};
+
+// Number of instructions executed since the CPU was last reset, halt excluded
+static CORE_LOCAL uint64_t instruction_count;
+// Loops fast-forwarded and iterations skipped since the CPU was last reset
+static CORE_LOCAL uint64_t fast_forwarded_loops;
+static CORE_LOCAL uint64_t fast_forwarded_iterations;
+
+// run_cpu stops at the end of the first basic block that takes the count to this limit
+static uint64_t instruction_limit = UINT64_MAX;
+// Set by stop_cpu, possibly from a signal handler, to make run_cpu stop at the end of the current basic block
+static volatile sig_atomic_t stop_requested;
+
+// Number of entries in the table of instructions known not to start a group, a power of two
+#define NOT_FUSED_TABLE_SIZE 1024
+// Instructions that looked like the start of a group but were not, one entry per PC modulo the
+// table size, each holding the key made by not_fused_key. exec_fused checks the table before
+// looking ahead, so the plain instructions of a hot loop pay for the lookahead only once. An entry
+// only ever stops a group from being fused, which never changes the result, so the table is shared
+// by every core through relaxed atomics and needs no invalidating when memory is written to.
+static uint64_t not_fused[NOT_FUSED_TABLE_SIZE];
+
+/**
+ * Reset the registers, processor state flags and memory to their initial values.
+ *
+ * This lets one process run several programs in turn, each starting from the same state.
+ */
+void reset_cpu(void) {
+    init_register();
+    init_memory();
+    pstate = (processor_state) {false, true, false, false};
+    instruction_count = 0;
+    fast_forwarded_loops = 0;
+    fast_forwarded_iterations = 0;
+    stop_requested = false;
+    memset(not_fused, 0, sizeof(not_fused));
+}
+
 /**
  * Initialize the CPU with register values and load instructions from a binary file into memory.
  *
  * @param input_file_path The path to the binary file containing instructions to load.
  *
- * @note If the file cannot be opened, an error message is printed to stderr, and the program exits.
+ * @note If the file cannot be opened, or is too large or cannot be read, a fault is raised.
  *
  * This function initializes the general-purpose registers and memory for the CPU.
  * It opens the specified binary file, loads the instructions into memory, and then closes the file.
  */
 void init_cpu(const char* input_file_path) {
-    //initialize general registers
-    init_register();
-
-    //initialize memory and load the instructions
-    init_memory();
+    //initialize registers, flags and memory
+    reset_cpu();
 
     //open file
     FILE *input_file = fopen(input_file_path, "rb");
     if (input_file == NULL) {
-        fprintf(stderr, "Failed to open file %s", input_file_path);
-        exit(EXIT_FAILURE);
+        fault_raise("Failed to open file %s\n", input_file_path);
     }
 
+    // Close the file before passing on a fault from loading it, so a batch run does not leak it
+    FaultHandler handler;
+    if (fault_catch(&handler) != 0) {
+        fclose(input_file);
+        fault_raise("%s", handler.message);
+    }
     load_instructions_to_memory(input_file);
+    fault_pop(&handler);
 
     fclose(input_file);
 }
 
+/**
+ * Initialize the CPU with register values and load instructions from a buffer into memory.
+ *
+ * @param instructions Buffer holding the instructions to load.
+ * @param num_instructions Number of instructions in the buffer.
+ */
+void init_cpu_buffer(const uint32_t *instructions, size_t num_instructions) {
+    reset_cpu();
+    load_instructions_to_memory_buffer(instructions, num_instructions);
+}
+
 /** Fetches an instruction from memory at the current program counter address. */
 static Instruction fetch(void) {
     Instruction inst;
-    inst.data = get_word(get_spec_register(PROGRAM_COUNTER));
+    inst.data = get_instruction(get_spec_register(PROGRAM_COUNTER));
     return inst;
 }
 
@@ -573,13 +627,13 @@ static void exec_branch_uncond(const BranchUncond inst) {
 }
 
 /**
- * @brief Execute a conditional branch instruction.
- * @param inst The segmented conditional branch instruction.
+ * @brief Checks whether the condition of a conditional branch holds for the current flags.
+ * @param cond The condition field of the conditional branch.
+ * @return true if the branch is taken, false if it falls through.
  */
-static void exec_branch_cond(const BranchCond inst) {
+bool condition_holds(uint32_t cond) {
     bool condition;
-    int64_t offset = sign_extend(inst.simm19, 19) * INSTR_SIZE;
-    switch(inst.cond){
+    switch(cond){
         case ITP_EQ:
             condition = pstate.zero_flag;
             break;
@@ -605,7 +659,16 @@ static void exec_branch_cond(const BranchCond inst) {
             condition = false;
             break;
     }
-    if (condition){
+    return condition;
+}
+
+/**
+ * @brief Execute a conditional branch instruction.
+ * @param inst The segmented conditional branch instruction.
+ */
+static void exec_branch_cond(const BranchCond inst) {
+    if (condition_holds(inst.cond)){
+        int64_t offset = sign_extend(inst.simm19, 19) * INSTR_SIZE;
         increase_pc(offset);
         return;
     }
@@ -707,8 +770,361 @@ static void decode_and_execute(const Instruction inst) {
         return;
     }
 
-    fprintf(stderr, "ERROR: %x: Unknown instruction at address: %lu\n", inst.data, get_spec_register(PROGRAM_COUNTER));
-    exit(EXIT_FAILURE);
+    fault_raise("ERROR: %x: Unknown instruction at address: %lu\n", inst.data, get_spec_register(PROGRAM_COUNTER));
+}
+
+// -----------------------------FUSED HANDLERS:----------------------------
+// Whether run_cpu executes common instruction sequences as fused groups (see exec_fused)
+static bool fusion_enabled = true;
+// Whether exec_fused skips the iterations of pure counting loops (see fast_forward)
+static bool fast_forward_enabled = false;
+
+// Key of an instruction in not_fused: its PC, plus one so that no key is zero, and the instruction
+static inline uint64_t not_fused_key(uint64_t pc, const Instruction inst) {
+    return (pc / INSTR_SIZE + 1) << 32 | inst.data;
+}
+
+// Slot of a PC in not_fused
+static inline uint64_t *not_fused_slot(uint64_t pc) {
+    return &not_fused[(pc / INSTR_SIZE) & (NOT_FUSED_TABLE_SIZE - 1)];
+}
+
+/**
+ * @brief Checks whether an instruction is an immediate or register add or subtract that leaves the flags alone.
+ */
+static bool is_plain_arithmetic(const Instruction inst) {
+    if (inst.gen_dp_imm.op0 == ITP_DP_IMM) {
+        return inst.imm_arith.opi == ITP_IMM_ARITH && !inst.imm_arith.opc_flag;
+    }
+    if (inst.gen_dp_reg.op0 == ITP_DP_REG && inst.reg_multiply.M != ITP_REG_MULTIPLY) {
+        return inst.reg_arith.id == ITP_REG_ARITH && !inst.reg_arith.opc_flag;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether an instruction sets the flags: adds, subs or ands, which includes cmp, cmn and tst.
+ */
+static bool sets_flags(const Instruction inst) {
+    if (inst.gen_dp_imm.op0 == ITP_DP_IMM) {
+        return inst.imm_arith.opi == ITP_IMM_ARITH && inst.imm_arith.opc_flag;
+    }
+    if (inst.gen_dp_reg.op0 == ITP_DP_REG && inst.reg_multiply.M != ITP_REG_MULTIPLY) {
+        if (inst.reg_arith.id == ITP_REG_ARITH) {
+            return inst.reg_arith.opc_flag;
+        }
+        return inst.reg_logic.opc == ITP_AND_W_FLAGS;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether an instruction is a conditional branch.
+ */
+static bool is_branch_cond(const Instruction inst) {
+    return inst.gen_branch.op0 == ITP_BRANCH
+        && inst.branch_unconditional.id != ITP_BRANCH_UNCOND
+        && inst.branch_conditional.id == ITP_BRANCH_COND;
+}
+
+/**
+ * @brief Checks whether an instruction is a wide move of the given kind (ITP_MOVZ or ITP_MOVK).
+ */
+static bool is_wide_move(const Instruction inst, uint32_t opc) {
+    return inst.gen_dp_imm.op0 == ITP_DP_IMM && inst.imm_wide.opi == ITP_WIDE_MOVE && inst.imm_wide.opc == opc;
+}
+
+/**
+ * @brief Executes an instruction that is_plain_arithmetic or sets_flags has accepted.
+ */
+static void exec_arithmetic_or_logic(const Instruction inst) {
+    if (inst.gen_dp_imm.op0 == ITP_DP_IMM) {
+        exec_imm_arithmetic(inst.imm_arith);
+    } else if (inst.reg_arith.id == ITP_REG_ARITH) {
+        exec_reg_arithmetic(inst.reg_arith);
+    } else {
+        exec_reg_logic(inst.reg_logic);
+    }
+}
+
+/**
+ * @brief Reads an add or sub that steps its own destination by a loop invariant amount.
+ *
+ * @param inst An instruction that is_plain_arithmetic or sets_flags has accepted.
+ * @param counter Set to the register being stepped.
+ * @param step Set to the amount added each time, negated for a sub.
+ * @return true if inst is such an instruction, false otherwise.
+ */
+static bool read_induction(const Instruction inst, uint32_t *counter, uint64_t *step) {
+    if (inst.gen_dp_imm.op0 == ITP_DP_IMM) {
+        if (inst.imm_arith.opi != ITP_IMM_ARITH || inst.imm_arith.rd != inst.imm_arith.rn) {
+            return false;
+        }
+        *counter = inst.imm_arith.rd;
+        *step = inst.imm_arith.sh ? (uint64_t) inst.imm_arith.imm12 << 12 : inst.imm_arith.imm12;
+        if (inst.imm_arith.opc_op) {
+            *step = -*step;
+        }
+    } else {
+        if (inst.reg_arith.id != ITP_REG_ARITH || inst.reg_arith.rd != inst.reg_arith.rn
+            || inst.reg_arith.rm == inst.reg_arith.rd) {
+            return false;
+        }
+        *counter = inst.reg_arith.rd;
+        *step = inst.reg_arith.sf
+            ? apply_shift_64(get_reg_value_64(inst.reg_arith.rm), inst.reg_arith.operand, inst.reg_arith.shift)
+            : apply_shift_32(get_reg_value_32(inst.reg_arith.rm), inst.reg_arith.operand, inst.reg_arith.shift);
+        if (inst.reg_arith.opc_op) {
+            *step = -*step;
+        }
+    }
+    return *counter != NUM_REGISTERS;
+}
+
+/**
+ * @brief Reads a cmp of a register against a loop invariant bound.
+ *
+ * @param inst An instruction that sets_flags has accepted.
+ * @param counter The register the cmp must compare.
+ * @param bound Set to the value the register is compared against.
+ * @return true if inst is such a cmp, false otherwise.
+ */
+static bool read_bound(const Instruction inst, uint32_t counter, uint64_t *bound) {
+    if (inst.gen_dp_imm.op0 == ITP_DP_IMM) {
+        if (inst.imm_arith.rd != NUM_REGISTERS || !inst.imm_arith.opc_op || inst.imm_arith.rn != counter) {
+            return false;
+        }
+        *bound = inst.imm_arith.sh ? (uint64_t) inst.imm_arith.imm12 << 12 : inst.imm_arith.imm12;
+        return true;
+    }
+    if (inst.reg_arith.id != ITP_REG_ARITH || inst.reg_arith.rd != NUM_REGISTERS || !inst.reg_arith.opc_op
+        || inst.reg_arith.rn != counter || inst.reg_arith.rm == counter) {
+        return false;
+    }
+    *bound = inst.reg_arith.sf
+        ? apply_shift_64(get_reg_value_64(inst.reg_arith.rm), inst.reg_arith.operand, inst.reg_arith.shift)
+        : apply_shift_32(get_reg_value_32(inst.reg_arith.rm), inst.reg_arith.operand, inst.reg_arith.shift);
+    return true;
+}
+
+/**
+ * @brief Works out how many times a counter must be stepped to first equal a bound.
+ *
+ * Solves start + n * step = bound modulo 2^width for the least n >= 1: the powers of two shared
+ * by step and the distance are divided out, leaving an odd step with an inverse modulo 2^width.
+ *
+ * @param start Value of the counter before the first step.
+ * @param step Amount added each step, modulo 2^width.
+ * @param bound Value the counter is compared against, modulo 2^width.
+ * @param width 32 or 64.
+ * @param iterations Set to n.
+ * @return true if there is such an n below 2^64, false if the counter never equals the bound.
+ */
+static bool iterations_until_equal(uint64_t start, uint64_t step, uint64_t bound, int width, uint64_t *iterations) {
+    uint64_t mask = width == 64 ? UINT64_MAX : ((uint64_t) 1 << width) - 1;
+    uint64_t distance = (bound - start) & mask;
+    if (step == 0) {
+        return false;
+    }
+    while ((step & 1) == 0) {
+        if (distance & 1) {
+            return false;
+        }
+        step >>= 1;
+        distance >>= 1;
+        mask >>= 1;
+    }
+    // Newton's iteration doubles the number of correct low bits each time, from 3 to 96
+    uint64_t inverse = step;
+    for (int i = 0; i < 5; i++) {
+        inverse *= 2 - step * inverse;
+    }
+    *iterations = (distance * inverse) & mask;
+    if (*iterations == 0) {
+        // Already equal, so the loop only stops once the counter comes all the way round
+        if (mask == UINT64_MAX) {
+            return false;
+        }
+        *iterations = mask + 1;
+    }
+    return true;
+}
+
+/**
+ * @brief Skips all but the last iteration of a loop that only counts a register up or down.
+ *
+ * The loop must be the group about to be run by exec_fused, branching back to its own start:
+ * - add or sub rX, rX, #imm or rY, then cmp rX, #imm or rZ, then b.ne to the add
+ * - adds or subs rX, rX, #imm or rY, then b.ne to the adds
+ * Nothing but rX and the flags changes inside such a loop, and the operands other than rX are
+ * loop invariant, so the number of iterations and the value of rX after them follow in closed
+ * form. rX is set to its value before the last iteration, which exec_fused then runs as usual,
+ * so that the flags and PC come out exactly as if every iteration had run. Fewer iterations are
+ * skipped if the instruction limit would be reached first, so run_cpu still stops where it would.
+ *
+ * @param step_inst The add or sub at the PC.
+ * @param compare The cmp after it, or NULL for a loop of two instructions.
+ * @param branch The conditional branch closing the loop.
+ * @param length Number of instructions in the loop.
+ * @return The number of instructions skipped, or 0 if the group is not such a loop.
+ */
+static uint64_t fast_forward(const Instruction step_inst, const Instruction *compare, const Instruction branch, int length) {
+    int64_t offset = sign_extend(branch.branch_conditional.simm19, 19) * INSTR_SIZE;
+    if (branch.branch_conditional.cond != ITP_NE || offset != -(int64_t) (length - 1) * INSTR_SIZE) {
+        return 0;
+    }
+
+    uint32_t counter;
+    uint64_t step;
+    uint64_t bound = 0;
+    if (!read_induction(step_inst, &counter, &step)
+        || (compare != NULL && (compare->imm_arith.sf != step_inst.imm_arith.sf || !read_bound(*compare, counter, &bound)))) {
+        return 0;
+    }
+    int width = step_inst.imm_arith.sf ? 64 : 32;
+    uint64_t mask = width == 64 ? UINT64_MAX : UINT32_MAX;
+    uint64_t start = width == 64 ? get_reg_value_64(counter) : get_reg_value_32(counter);
+    uint64_t iterations;
+    if (!iterations_until_equal(start, step & mask, bound & mask, width, &iterations)) {
+        return 0;
+    }
+
+    // run_cpu stops after the first iteration that takes the count to the limit
+    uint64_t skipped = iterations - 1;
+    if (instruction_limit != UINT64_MAX) {
+        uint64_t allowed = instruction_count < instruction_limit ? (instruction_limit - instruction_count - 1) / length : 0;
+        if (skipped > allowed) {
+            skipped = allowed;
+        }
+    }
+    if (skipped == 0) {
+        return 0;
+    }
+    set_reg_value(counter, (start + skipped * step) & mask);
+    fast_forwarded_loops++;
+    fast_forwarded_iterations += skipped;
+    return skipped * length;
+}
+
+/**
+ * @brief Executes the group of instructions starting at the PC as one fused handler, if it is a
+ *        group that is worth fusing.
+ *
+ * The groups are the idioms hot loops are made of:
+ * - a flag setting instruction (adds, subs, ands, so also cmp, cmn and tst) then a b.cond
+ * - an add or sub, then a flag setting instruction, then a b.cond (counting loops)
+ * - a movz then movk instructions into the same register (building a constant)
+ *
+ * When set_fast_forward has turned it on, a group of the first two kinds that is a whole counting
+ * loop on its own first has all but its last iteration skipped by fast_forward.
+ *
+ * The members of a group are recognised from their fields and run by their own handlers straight
+ * away, skipping run_cpu's loop and decode_and_execute's dispatch for each one. Every member still
+ * updates the registers, flags and PC exactly as it would on its own, so the state after a group is
+ * the same as after running its members one at a time. None of the members reads or writes memory
+ * other than to be fetched, and groups are only formed within RAM, so looking ahead cannot fault or
+ * reach a device.
+ *
+ * @param inst The instruction at the PC, already fetched.
+ * @return The number of instructions executed, skipped ones included, with the PC left after the
+ *         last of them, or 0 if inst does not start a group, in which case nothing has been executed.
+ */
+static uint64_t exec_fused(const Instruction inst) {
+    bool flags = sets_flags(inst);
+    if (!flags && !is_plain_arithmetic(inst) && !is_wide_move(inst, ITP_MOVZ)) {
+        return 0;
+    }
+    uint64_t pc = get_spec_register(PROGRAM_COUNTER);
+    if (pc > NUM_OF_MEMORY_ADDRESS - 3 * INSTR_SIZE) {
+        return 0;
+    }
+    uint64_t key = not_fused_key(pc, inst);
+    if (__atomic_load_n(not_fused_slot(pc), __ATOMIC_RELAXED) == key) {
+        return 0;
+    }
+    Instruction next = {.data = get_instruction(pc + INSTR_SIZE)};
+
+    if (flags) {
+        if (!is_branch_cond(next)) {
+            __atomic_store_n(not_fused_slot(pc), key, __ATOMIC_RELAXED);
+            return 0;
+        }
+        uint64_t skipped = fast_forward_enabled ? fast_forward(inst, NULL, next, 2) : 0;
+        exec_arithmetic_or_logic(inst);
+        increment_pc();
+        exec_branch_cond(next.branch_conditional);
+        return skipped + 2;
+    }
+
+    if (is_plain_arithmetic(inst)) {
+        if (!sets_flags(next)) {
+            __atomic_store_n(not_fused_slot(pc), key, __ATOMIC_RELAXED);
+            return 0;
+        }
+        Instruction branch = {.data = get_instruction(pc + 2 * INSTR_SIZE)};
+        if (!is_branch_cond(branch)) {
+            __atomic_store_n(not_fused_slot(pc), key, __ATOMIC_RELAXED);
+            return 0;
+        }
+        uint64_t skipped = fast_forward_enabled ? fast_forward(inst, &next, branch, 3) : 0;
+        exec_arithmetic_or_logic(inst);
+        increment_pc();
+        exec_arithmetic_or_logic(next);
+        increment_pc();
+        exec_branch_cond(branch.branch_conditional);
+        return skipped + 3;
+    }
+
+    // A movz, then as many movk instructions into the same register as follow it
+    if (!is_wide_move(next, ITP_MOVK) || next.imm_wide.rd != inst.imm_wide.rd) {
+        __atomic_store_n(not_fused_slot(pc), key, __ATOMIC_RELAXED);
+        return 0;
+    }
+    exec_wide_move(inst.imm_wide);
+    increment_pc();
+    uint64_t executed = 1;
+    while (is_wide_move(next, ITP_MOVK) && next.imm_wide.rd == inst.imm_wide.rd) {
+        exec_wide_move(next.imm_wide);
+        increment_pc();
+        executed++;
+        pc += INSTR_SIZE;
+        if (pc > NUM_OF_MEMORY_ADDRESS - 2 * INSTR_SIZE) {
+            break;
+        }
+        next.data = get_instruction(pc + INSTR_SIZE);
+    }
+    return executed;
+}
+
+/**
+ * @brief Turns the fused handlers of run_cpu on or off, for example to compare their speed.
+ *
+ * @param enabled Whether run_cpu should execute fused groups (the default).
+ */
+void set_fusion(bool enabled) {
+    fusion_enabled = enabled;
+}
+
+/**
+ * @brief Turns the fast-forwarding of pure counting loops on or off (see fast_forward).
+ *
+ * It only takes effect while fusion is on, as the loops are found among the fused groups.
+ *
+ * @param enabled Whether run_cpu should skip the iterations of such loops (off by default).
+ */
+void set_fast_forward(bool enabled) {
+    fast_forward_enabled = enabled;
+}
+
+/**
+ * @brief Gets how much fast_forward has skipped since the CPU was last reset.
+ *
+ * @param loops Set to the number of loops fast-forwarded.
+ * @param iterations Set to the number of iterations skipped in them.
+ */
+void get_fast_forward_stats(uint64_t *loops, uint64_t *iterations) {
+    *loops = fast_forwarded_loops;
+    *iterations = fast_forwarded_iterations;
 }
 
 // -----------------------------RUN FUNC:----------------------------
@@ -722,22 +1138,118 @@ static void decode_and_execute(const Instruction inst) {
  * The function prints debugging information for each fetched instruction before decoding and executing it,
  * including the instruction in hexadecimal format and its corresponding program counter (PC).
  * After executing each instruction (except branch instructions), the program counter is incremented.
+ *
+ * Unless set_fusion has turned them off, common sequences of instructions are executed by fused
+ * handlers (see exec_fused), with the same effect as executing them one by one.
+ *
+ * The instruction limit and stop requests are only checked after branch instructions and fused
+ * groups, that is about once per basic block, which keeps the check off the path of every other
+ * instruction. Any loop that never halts contains a branch, so it is still stopped.
+ *
+ * @return true if the CPU halted, false if it was stopped by the instruction limit or stop_cpu.
  */
-void run_cpu(void) {
+bool run_cpu(void) {
     Instruction inst = fetch();
 
     while (inst.data != HALT_INSTRUCTION) {
         // Debuggings print statements to display all information every fde cycle:
         debug_printf("FETCH: 0x%x | PC: 0x%lx\nBinary: ", inst.data, get_spec_register(PROGRAM_COUNTER));
+#ifdef DEBUGGING_MODE
         print_bits(inst.data);
+#endif
+
+        uint64_t fused = fusion_enabled ? exec_fused(inst) : 0;
+        if (fused > 0) {
+            instruction_count += fused;
+            if (instruction_count >= instruction_limit || stop_requested) {
+                return false;
+            }
+            inst = fetch();
+            continue;
+        }
 
         decode_and_execute(inst);
+        instruction_count++;
         // Increment PC if instruction wasn't a branch instruction:
         if (inst.gen_branch.op0 != ITP_BRANCH) {
             increment_pc();
+        } else if (instruction_count >= instruction_limit || stop_requested) {
+            return false;
+        }
+        inst = fetch();
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the number of instructions after which run_cpu and run_cpu_timed stop.
+ *
+ * The limit is checked at the end of each basic block, so the CPU may run a few instructions past it.
+ *
+ * @param limit Number of instructions, or UINT64_MAX for no limit.
+ */
+void set_instruction_limit(uint64_t limit) {
+    instruction_limit = limit;
+}
+
+/**
+ * @brief Makes run_cpu or run_cpu_timed stop at the end of the current basic block.
+ *
+ * This is safe to call from a signal handler, for example to enforce a time limit.
+ */
+void stop_cpu(void) {
+    stop_requested = true;
+}
+
+/**
+ * @brief Works out the timing class of an instruction that has just been executed.
+ *
+ * @param inst The instruction.
+ * @param pc The address the instruction was fetched from.
+ * @return The class the timing model charges the instruction as.
+ */
+static InstructionClass classify(const Instruction inst, uint64_t pc) {
+    if (inst.gen_branch.op0 == ITP_BRANCH) {
+        // A conditional branch that falls through has moved the PC on by one instruction itself
+        if (inst.branch_conditional.id == ITP_BRANCH_COND && get_spec_register(PROGRAM_COUNTER) == pc + INSTR_SIZE) {
+            return TIMING_BRANCH_NOT_TAKEN;
+        }
+        return TIMING_BRANCH_TAKEN;
+    }
+    if (inst.gen_dp_reg.op0 == ITP_DP_REG && inst.reg_multiply.M == ITP_REG_MULTIPLY) {
+        return TIMING_MULTIPLY;
+    }
+    if (inst.gen_dt.op0_1 == ITP_DT_1 && inst.gen_dt.op0_2 == ITP_DT_2) {
+        return TIMING_LOAD_STORE;
+    }
+    return TIMING_ALU;
+}
+
+/**
+ * @brief Runs the CPU like run_cpu, charging every instruction to the timing model.
+ *
+ * This is kept apart from run_cpu so that running without the timing model pays nothing for it.
+ * The timing model must have been started with timing_init.
+ *
+ * @return true if the CPU halted, false if it was stopped by the instruction limit or stop_cpu.
+ */
+bool run_cpu_timed(void) {
+    Instruction inst = fetch();
+
+    while (inst.data != HALT_INSTRUCTION) {
+        uint64_t pc = get_spec_register(PROGRAM_COUNTER);
+        decode_and_execute(inst);
+        instruction_count++;
+        if (inst.gen_branch.op0 != ITP_BRANCH) {
+            increment_pc();
+        }
+        timing_charge(classify(inst, pc));
+        if (inst.gen_branch.op0 == ITP_BRANCH && (instruction_count >= instruction_limit || stop_requested)) {
+            return false;
         }
         inst = fetch();
     }
+    return true;
 }
 
 // ----------------------------PRINT_CPU FUNC:---------------------------
@@ -763,21 +1275,43 @@ void print_cpu(const char* output_file_path) {
         output_file = fopen(output_file_path, "w");
     }
 
-    print_registers(output_file);
-
-    fprintf(output_file, "PSTATE : %s%s%s%s\n", \
-    pstate.negative_flag ? "N" : "-", \
-    pstate.zero_flag     ? "Z" : "-", \
-    pstate.carry_flag    ? "C" : "-", \
-    pstate.overflow_flag ? "V" : "-");
-    
-    print_memory(output_file);
+    write_cpu(output_file);
 
     if (output_file_path) {
         fclose(output_file);
     }
 }
 
+/**
+ * @brief Write CPU state information to an already open stream, in the format of print_cpu.
+ *
+ * @param output_file Stream to write to.
+ */
+void write_cpu(FILE *output_file) {
+    OutputBuffer *ob = output_buffer_init();
+    format_registers(ob);
+    format_pstate(ob, pstate);
+    format_memory(ob);
+
+    output_buffer_write(ob, output_file);
+    output_buffer_free(ob);
+}
+
+/**
+ * @brief Formats the processor state flags into an output buffer, as the "PSTATE : NZCV" line of print_cpu.
+ *
+ * @param ob The output buffer to append the line to.
+ * @param state The flags to format, with a clear flag shown as '-'.
+ */
+void format_pstate(OutputBuffer *ob, processor_state state) {
+    output_buffer_append(ob, "PSTATE : ");
+    output_buffer_append(ob, state.negative_flag ? "N" : "-");
+    output_buffer_append(ob, state.zero_flag     ? "Z" : "-");
+    output_buffer_append(ob, state.carry_flag    ? "C" : "-");
+    output_buffer_append(ob, state.overflow_flag ? "V" : "-");
+    output_buffer_append(ob, "\n");
+}
+
 // ----------------------------USED IN DEBUGGER:---------------------------
 
 /**
@@ -796,12 +1330,75 @@ void print_cpu(const char* output_file_path) {
 bool step_instruction(){
     Instruction inst = fetch();
     decode_and_execute(inst);
+    if (inst.data != HALT_INSTRUCTION) {
+        instruction_count++;
+    }
     if (inst.gen_branch.op0 != ITP_BRANCH) {
         increment_pc();
     }
     return inst.data != HALT_INSTRUCTION;
 }
 
+/* To check whether a limit stopped run_cpu rather than the instruction limit (e.g. for co-simulation) */
+bool cpu_stop_requested(void) {
+    return stop_requested;
+}
+
+/**
+ * @brief Saves the whole state of the CPU: registers, flags, instruction count and memory.
+ *
+ * The stack pointer is left out, since no instruction can write to it. While writes are tracked
+ * (see memory_track_writes), only the pages of memory written since the last reset are copied, so
+ * the snapshot must be zeroed (as static storage is) or hold an earlier snapshot.
+ *
+ * @param snapshot Snapshot to fill in.
+ */
+void cpu_snapshot(CpuSnapshot *snapshot) {
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        snapshot->registers[i] = get_reg_value_64(i);
+    }
+    snapshot->program_counter = get_spec_register(PROGRAM_COUNTER);
+    snapshot->pstate = pstate;
+    snapshot->instruction_count = instruction_count;
+    memory_snapshot(snapshot->memory, snapshot->written_pages);
+}
+
+/**
+ * @brief Restores the whole state of the CPU from a snapshot.
+ *
+ * @param snapshot Snapshot filled in by cpu_snapshot.
+ */
+void cpu_restore(const CpuSnapshot *snapshot) {
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        set_reg_value(i, snapshot->registers[i]);
+    }
+    set_spec_register(PROGRAM_COUNTER, snapshot->program_counter);
+    pstate = snapshot->pstate;
+    instruction_count = snapshot->instruction_count;
+    memory_restore(snapshot->memory, snapshot->written_pages);
+}
+
+/**
+ * @brief Clones the whole emulated machine into a child process, to explore a variant from here.
+ *
+ * The registers, flags, instruction count, memory and devices live in module globals, so the
+ * child starts from exactly the current state, and later changes on either side are invisible
+ * to the other. The kernel shares memory pages copy-on-write, so unlike cpu_snapshot a child
+ * only costs the pages it dirties, and any number of variants can branch off one warm-up run.
+ * stdio buffers are flushed first, so that output written before the fork appears only once.
+ *
+ * @return 0 in the child, the process ID of the child in the parent, or -1 if the fork failed.
+ */
+pid_t machine_fork(void) {
+    fflush(NULL);
+    return fork();
+}
+
+/* To retrieve the number of instructions executed since the last reset (e.g. for emulate --stats) */
+uint64_t get_instruction_count(void) {
+    return instruction_count;
+}
+
 /* To retrieve the pstate in other files (e.g. debug_logic)*/
 processor_state get_pstate(){
     return pstate;
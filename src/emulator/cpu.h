@@ -8,8 +8,13 @@
 #define CPU_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <sys/types.h>
 #include "../instructions.h"
 #include "../ADTs/hashmap.h"
+#include "memory.h"
+#include "register.h"
 
 // Instruction size in bytes
 #define INSTR_SIZE 4
@@ -31,10 +36,36 @@ typedef struct {
     bool overflow_flag;   // Flag indicating arithmetic overflow
 } processor_state;
 
+// Complete state of the CPU and its memory, for saving and restoring it
+typedef struct {
+    uint64_t registers[NUM_REGISTERS];      // General purpose registers
+    uint64_t program_counter;
+    processor_state pstate;
+    uint64_t instruction_count;
+    uint8_t memory[NUM_OF_MEMORY_ADDRESS];
+    uint8_t written_pages[NUM_MEMORY_PAGES];  // Pages of memory that may be non-zero; the rest are zero
+} CpuSnapshot;
+
 // Extern function declarations
+extern void reset_cpu(void);                         // Reset registers, flags and memory
 extern void init_cpu(const char* input_file_path);   // Initialize CPU with instructions from file
-extern void run_cpu(void);                           // Run CPU simulation
+extern void init_cpu_buffer(const uint32_t *instructions, size_t num_instructions); // Initialize CPU with instructions from a buffer
+extern bool run_cpu(void);                           // Run CPU simulation, returning false if stopped before halting
+extern bool run_cpu_timed(void);                     // Run CPU simulation, charging the timing model
+extern void set_instruction_limit(uint64_t limit);   // Stop running after about this many instructions
+extern void stop_cpu(void);                          // Stop running at the end of the current basic block
+extern void set_fusion(bool enabled);                // Turn run_cpu's fused handlers on or off
+extern void set_fast_forward(bool enabled);          // Turn skipping the iterations of pure counting loops on or off
+extern void get_fast_forward_stats(uint64_t *loops, uint64_t *iterations); // Loops fast-forwarded and iterations skipped
+extern bool cpu_stop_requested(void);                // Whether stop_cpu has been called since the last reset
+extern void cpu_snapshot(CpuSnapshot *snapshot);     // Save the whole state of the CPU
+extern void cpu_restore(const CpuSnapshot *snapshot); // Restore a state saved by cpu_snapshot
+extern pid_t machine_fork(void);                     // Clone the machine into a child process, like fork
 extern bool step_instruction();
 extern void print_cpu(const char* output_file_path); // Print CPU state to file or stdout
+extern void write_cpu(FILE *output_file);            // Write CPU state to an open stream
+extern void format_pstate(OutputBuffer *ob, processor_state state); // Format a "PSTATE : NZCV" line
 extern processor_state get_pstate();
+extern bool condition_holds(uint32_t cond);          // Whether a conditional branch with this condition is taken
+extern uint64_t get_instruction_count(void);         // Instructions executed since the last reset
 #endif
@@ -10,52 +10,491 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/time.h>
 #include "cpu.h"
+#include "gpio.h"
+#include "timing.h"
+#include "cosim.h"
+#include "smp.h"
+#include "profile.h"
+#include "plugin.h"
+#include "expect.h"
+#include "../fault.h"
 
-void emulate(const char *input_file_path, const char *output_file_path) {
+// Options given on the command line
+typedef struct {
+  bool print_stats;   // --stats: report the number of instructions executed on stderr
+  bool attach_gpio;   // --gpio: attach the Raspberry Pi GPIO controller, logging pin changes on stderr
+  bool timing;        // --timing: run the timing model and report cycles on stderr
+  const char *cost_file_path;   // --costs FILE: cost table for the timing model, implies --timing
+  uint64_t max_instructions;    // --max-instructions N: stop after about N instructions, UINT64_MAX for no limit
+  uint64_t timeout_ms;          // --timeout MS: stop after about MS milliseconds, 0 for no limit
+  uint64_t cosim_interval;      // --cosim N: check run_cpu against the reference every N instructions, 0 for off
+  bool no_fusion;     // --no-fusion: execute every instruction on its own, without run_cpu's fused handlers
+  bool fast_forward;  // --fast-forward: skip the iterations of pure counting loops in closed form
+  int num_cores;      // --cores N: number of cores sharing memory, each on its own host thread
+  uint64_t profile_period;      // --profile N: sample the PC every N instructions, 0 for off
+  uint64_t profile_timer_us;    // --profile-timer US: sample the PC every US microseconds of CPU time, 0 for off
+  const char *folded_file_path; // --profile-folded FILE: write the samples as folded stacks to FILE
+  const char *plugin_paths[MAX_PLUGINS];  // --plugin FILE: instrumentation plugins to load, in order
+  int num_plugins;
+  const char *expected_file_path; // --expect FILE: compare the final state with FILE instead of printing it
+  const char *batch_file_path;    // --batch LIST: run every program listed in LIST, checking each one
+} EmulateOptions;
+
+// Exit status when the program was stopped by --max-instructions or --timeout rather than halting
+#define EXIT_LIMIT_REACHED 2
+// Exit status when --cosim finds that run_cpu and the reference disagree
+#define EXIT_DIVERGED 3
+// Exit status when --expect or --batch finds a final state that differs from the expected one, or a batch program fails
+#define EXIT_MISMATCH 4
+// Longest line of a --batch list file, including the newline
+#define MAX_BATCH_LINE_LENGTH 1024
+
+// Handler for the --timeout timer
+static void handle_timeout(int signal_number) {
+  stop_cpu();
+}
+
+/**
+ * Starts a one-shot timer that stops the CPU once the given number of milliseconds have passed.
+ */
+static void start_timeout(uint64_t timeout_ms) {
+  signal(SIGALRM, handle_timeout);
+  struct itimerval timer = {
+    .it_value = {.tv_sec = timeout_ms / 1000, .tv_usec = timeout_ms % 1000 * 1000}
+  };
+  setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+/**
+ * Cancels the timer started by start_timeout, if it has not gone off yet.
+ */
+static void cancel_timeout(void) {
+  struct itimerval timer = {0};
+  setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+/**
+ * Runs a program, printing the CPU state once it halts or a limit stops it.
+ *
+ * @return EXIT_SUCCESS if the program halted, EXIT_LIMIT_REACHED if it was stopped by a limit,
+ *         or EXIT_DIVERGED if co-simulation found a divergence.
+ */
+int emulate(const char *input_file_path, const char *output_file_path, const EmulateOptions *options) {
+  // Read the expected output first, so that a malformed file is reported before the program runs
+  if (options->expected_file_path != NULL) {
+    expect_load(options->expected_file_path);
+  }
+  // Co-simulation copies and compares memory every stretch, so let it skip the pages never written
+  if (options->cosim_interval > 0) {
+    memory_track_writes(true);
+  }
   // Initialize CPU with instructions from input file
   init_cpu(input_file_path);
+  if (options->attach_gpio) {
+    gpio_attach(stderr);
+  }
+  set_instruction_limit(options->max_instructions);
+  set_fusion(!options->no_fusion);
+  set_fast_forward(options->fast_forward);
+  for (int i = 0; i < options->num_plugins; i++) {
+    plugin_load(options->plugin_paths[i]);
+  }
+  if (options->timeout_ms > 0) {
+    start_timeout(options->timeout_ms);
+  }
   // Run CPU simulation
-  run_cpu();
-  // Print CPU state to output file or stdout
-  print_cpu(output_file_path);
+  bool halted;
+  CoreState cores[MAX_CORES];
+  if (options->profile_timer_us > 0) {
+    profile_start_timer(options->profile_timer_us);
+  }
+  if (options->num_cores > 1) {
+    halted = smp_run(options->num_cores, cores);
+  } else if (options->profile_period > 0) {
+    halted = profile_run(options->profile_period, options->max_instructions);
+  } else if (plugin_loaded()) {
+    halted = plugin_run(options->max_instructions);
+  } else if (options->cosim_interval > 0) {
+    CosimResult result = cosim_run(run_cpu, options->cosim_interval, options->max_instructions, stderr);
+    if (result == COSIM_DIVERGED) {
+      return EXIT_DIVERGED;
+    }
+    halted = result == COSIM_HALTED;
+  } else if (options->timing) {
+    timing_init(options->cost_file_path);
+    halted = run_cpu_timed();
+  } else {
+    halted = run_cpu();
+  }
+  if (options->profile_timer_us > 0) {
+    profile_stop_timer();
+  }
+  // Print CPU state to output file or stdout, which is the partial state if a limit was reached.
+  // With --expect the state is only written if an output file was given.
+  uint64_t instructions;
+  int mismatches = 0;
+  if (options->num_cores > 1) {
+    smp_print(output_file_path, options->num_cores, cores);
+    instructions = smp_instruction_count(options->num_cores, cores);
+  } else {
+    if (options->expected_file_path == NULL || output_file_path != NULL) {
+      print_cpu(output_file_path);
+    }
+    if (options->expected_file_path != NULL) {
+      mismatches = expect_check(stderr, input_file_path);
+    }
+    instructions = get_instruction_count();
+  }
+
+  if (!halted) {
+    fprintf(stderr, "Stopped by %s after %lu instructions\n",
+            cpu_stop_requested() ? "timeout" : "instruction limit", instructions);
+  }
+  if (options->print_stats) {
+    fprintf(stderr, "Instructions: %lu\n", instructions);
+    if (options->fast_forward) {
+      uint64_t loops, iterations;
+      get_fast_forward_stats(&loops, &iterations);
+      fprintf(stderr, "Fast-forwarded loops: %lu (%lu iterations skipped)\n", loops, iterations);
+    }
+  }
+  if (options->timing) {
+    timing_report(stderr);
+  }
+  if (options->profile_period > 0 || options->profile_timer_us > 0) {
+    FILE *folded_file = NULL;
+    if (options->folded_file_path != NULL && (folded_file = fopen(options->folded_file_path, "w")) == NULL) {
+      fprintf(stderr, "Failed to open file %s\n", options->folded_file_path);
+      exit(EXIT_FAILURE);
+    }
+    profile_report(stderr, folded_file);
+    if (folded_file != NULL) {
+      fclose(folded_file);
+    }
+  }
+  if (mismatches > 0) {
+    return EXIT_MISMATCH;
+  }
+  return halted ? EXIT_SUCCESS : EXIT_LIMIT_REACHED;
+}
+
+/**
+ * Runs one program of a batch, checking its final state against an expected output file if one is given.
+ *
+ * A fault, such as an unknown instruction or a program or expected file that cannot be read,
+ * fails the program and is reported, and the batch carries on with the next one.
+ *
+ * @return true if the program halted and, when there is an expected output file, its final state matched.
+ */
+static bool run_batch_entry(const char *input_file_path, const char *expected_file_path,
+                            const EmulateOptions *options, uint64_t *instructions) {
+  FaultHandler handler;
+  if (fault_catch(&handler) != 0) {
+    cancel_timeout();
+    fprintf(stderr, "%s: %s", input_file_path, handler.message);
+    return false;
+  }
+  if (expected_file_path != NULL) {
+    expect_load(expected_file_path);
+  }
+  init_cpu(input_file_path);
+  if (options->timeout_ms > 0) {
+    start_timeout(options->timeout_ms);
+  }
+  bool halted = run_cpu();
+  cancel_timeout();
+  fault_pop(&handler);
+
+  *instructions += get_instruction_count();
+  if (!halted) {
+    fprintf(stderr, "%s: Stopped by %s after %lu instructions\n", input_file_path,
+            cpu_stop_requested() ? "timeout" : "instruction limit", get_instruction_count());
+  }
+  bool matched = expected_file_path == NULL || expect_check(stderr, input_file_path) == 0;
+  return halted && matched;
+}
+
+/**
+ * Runs every program listed in a batch list file, reporting only the programs that fail.
+ *
+ * Each line of the list names a program and optionally its expected output file, separated by
+ * whitespace. Blank lines and lines starting with '#' are skipped. A summary of how many programs
+ * passed and failed is printed to stderr at the end.
+ *
+ * @return EXIT_SUCCESS if every program passed, otherwise EXIT_MISMATCH.
+ */
+static int run_batch(const char *batch_file_path, const EmulateOptions *options) {
+  FILE *batch_file = fopen(batch_file_path, "r");
+  if (batch_file == NULL) {
+    fprintf(stderr, "Failed to open file %s\n", batch_file_path);
+    exit(EXIT_FAILURE);
+  }
+  set_instruction_limit(options->max_instructions);
+  set_fusion(!options->no_fusion);
+  set_fast_forward(options->fast_forward);
+  // Memory is reset before every program, which need only clear the pages the last one wrote
+  memory_track_writes(true);
+
+  char line[MAX_BATCH_LINE_LENGTH];
+  int line_number = 0, passed = 0, failed = 0;
+  uint64_t instructions = 0;
+  while (fgets(line, MAX_BATCH_LINE_LENGTH, batch_file) != NULL) {
+    line_number++;
+    const char *separators = " \t\r\n";
+    char *input_file_path = strtok(line, separators);
+    if (input_file_path == NULL || input_file_path[0] == '#') {
+      continue;
+    }
+    char *expected_file_path = strtok(NULL, separators);
+    if (expected_file_path != NULL && strtok(NULL, separators) != NULL) {
+      fprintf(stderr, "%s:%d: Expected a program and at most one expected output file\n", batch_file_path, line_number);
+      exit(EXIT_FAILURE);
+    }
+
+    if (run_batch_entry(input_file_path, expected_file_path, options, &instructions)) {
+      passed++;
+    } else {
+      failed++;
+    }
+  }
+  fclose(batch_file);
+
+  fprintf(stderr, "Batch: %d passed, %d failed\n", passed, failed);
+  if (options->print_stats) {
+    fprintf(stderr, "Instructions: %lu\n", instructions);
+  }
+  return failed == 0 ? EXIT_SUCCESS : EXIT_MISMATCH;
+}
+
+/**
+ * Parses the value of a numeric option, exiting with an error if it is not a whole number.
+ */
+static uint64_t parse_count(const char *option, const char *value) {
+  char *end;
+  unsigned long long count = strtoull(value, &end, 10);
+  if (*value == '\0' || *value == '-' || *end != '\0') {
+    fprintf(stderr, "Invalid value %s for %s\n", value, option);
+    exit(EXIT_FAILURE);
+  }
+  return count;
 }
 
 /**
  * Main function for a simple CPU simulator.
  *
- * Parses command-line arguments for input and optionally output file paths.
+ * Parses command-line options, then the input and optionally output file paths.
  * Initializes the CPU with instructions from the input file.
  * Runs the CPU simulation.
  * Prints CPU state information to the specified output file or stdout.
  *
+ * Options:
+ * - "--stats": print the number of instructions executed to stderr once the CPU halts.
+ * - "--gpio": attach the Raspberry Pi 3 GPIO controller and log every change of an output pin to stderr.
+ * - "--timing": run the cycle-approximate timing model and print total cycles, CPI and cache
+ *   statistics to stderr once the CPU halts.
+ * - "--costs FILE": read the timing model's cost table from FILE (see timing.c); implies "--timing".
+ * - "--max-instructions N": stop after N instructions, or at the end of the basic block reaching N.
+ * - "--timeout MS": stop after MS milliseconds of wall time, at the end of a basic block.
+ * - "--cosim N": run the program with run_cpu and the single-step reference in lockstep, comparing
+ *   registers, flags and memory every N instructions, and report the first basic block where
+ *   they disagree (exit status EXIT_DIVERGED). Cannot be combined with "--timing" or "--gpio".
+ * - "--no-fusion": run every instruction through the plain fetch-decode-execute loop, without the
+ *   fused handlers for compare-and-branch and similar idioms. The results are the same either way.
+ * - "--fast-forward": compute the outcome of loops that only count a register up or down to a
+ *   loop-invariant bound (add, cmp, b.ne back to the add) instead of running every iteration.
+ *   The results are the same either way; with "--stats" the loops skipped are reported too.
+ *   Has no effect with "--no-fusion".
+ * - "--cores N": run N cores (up to MAX_CORES) on their own host threads, sharing memory. Every core
+ *   starts at address 0 with its number in x0, and the output has the registers and PSTATE of
+ *   every core before the shared memory. See smp.h for the memory ordering guarantee.
+ *   Cannot be combined with "--timing", "--gpio" or "--cosim".
+ * - "--profile N": sample the PC every N instructions, at the end of the basic block reaching each
+ *   sample point, and print a flat profile of the hottest addresses to stderr once the CPU halts.
+ * - "--profile-timer US": sample the PC on a host timer every US microseconds of CPU time instead,
+ *   which costs nothing between samples.
+ * - "--profile-folded FILE": also write the samples to FILE as folded stacks for flame graph tools,
+ *   with the caller guessed from x30 (see profile.h). Needs "--profile" or "--profile-timer".
+ *   Profiling cannot be combined with "--cosim" or "--cores", and "--profile" not with "--timing" or "--profile-timer".
+ * - "--plugin FILE": load an instrumentation plugin from the shared object FILE (see plugin.h), which
+ *   is told about every retired instruction, memory access, taken branch and the halt. May be given
+ *   up to MAX_PLUGINS times. Cannot be combined with "--timing", "--cosim", "--cores" or "--profile".
+ * - "--expect FILE": compare the final registers, PSTATE and non-zero memory with FILE, an expected
+ *   output in the format the emulator prints, and report only what differs on stderr (exit status
+ *   EXIT_MISMATCH if anything does). The state itself is only written if an output file is given.
+ *   Cannot be combined with "--cores".
+ * - "--batch LIST": run every program listed in LIST in turn, in place of the input file. Each line
+ *   holds a program and optionally its expected output file, which is checked as with "--expect".
+ *   Only the programs that fault, hit a limit or mismatch are reported, followed by a count of
+ *   passes and failures (exit status EXIT_MISMATCH if any failed). Cannot be combined with
+ *   "--timing", "--gpio", "--cosim", "--cores", "--profile", "--plugin" or "--expect".
+ * When a limit stops the program, the state at that point is printed as usual and the exit
+ * status is EXIT_LIMIT_REACHED.
+ *
  * @param argc Number of command-line arguments.
  * @param argv Array of command-line argument strings.
- * @return EXIT_SUCCESS if the program executes successfully, otherwise EXIT_FAILURE.
+ * @return EXIT_SUCCESS if the program halts, EXIT_LIMIT_REACHED if a limit stops it, EXIT_DIVERGED
+ *         if co-simulation finds a divergence, EXIT_MISMATCH if the final state is not the expected
+ *         one, otherwise EXIT_FAILURE.
  */
 int main(int argc, char **argv) {
+  EmulateOptions options = {false, false, false, NULL, UINT64_MAX, 0, 0, false, false, 1, 0, 0, NULL, {NULL}, 0, NULL, NULL};
+  int arg_index = 1;
+
+  // Options all come before the file paths
+  while (arg_index < argc && strncmp(argv[arg_index], "--", 2) == 0) {
+    if (strcmp(argv[arg_index], "--stats") == 0) {
+      options.print_stats = true;
+      arg_index++;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--gpio") == 0) {
+      options.attach_gpio = true;
+      arg_index++;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--timing") == 0) {
+      options.timing = true;
+      arg_index++;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--no-fusion") == 0) {
+      options.no_fusion = true;
+      arg_index++;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--fast-forward") == 0) {
+      options.fast_forward = true;
+      arg_index++;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--costs") == 0 && arg_index + 1 < argc) {
+      options.timing = true;
+      options.cost_file_path = argv[arg_index + 1];
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--max-instructions") == 0 && arg_index + 1 < argc) {
+      options.max_instructions = parse_count(argv[arg_index], argv[arg_index + 1]);
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--timeout") == 0 && arg_index + 1 < argc) {
+      options.timeout_ms = parse_count(argv[arg_index], argv[arg_index + 1]);
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--cores") == 0 && arg_index + 1 < argc) {
+      uint64_t num_cores = parse_count(argv[arg_index], argv[arg_index + 1]);
+      if (num_cores < 1 || num_cores > MAX_CORES) {
+        fprintf(stderr, "--cores must be between 1 and %d\n", MAX_CORES);
+        return EXIT_FAILURE;
+      }
+      options.num_cores = num_cores;
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--profile") == 0 && arg_index + 1 < argc) {
+      options.profile_period = parse_count(argv[arg_index], argv[arg_index + 1]);
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--profile-timer") == 0 && arg_index + 1 < argc) {
+      options.profile_timer_us = parse_count(argv[arg_index], argv[arg_index + 1]);
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--profile-folded") == 0 && arg_index + 1 < argc) {
+      options.folded_file_path = argv[arg_index + 1];
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--plugin") == 0 && arg_index + 1 < argc) {
+      if (options.num_plugins == MAX_PLUGINS) {
+        fprintf(stderr, "Too many plugins, at most %d can be loaded\n", MAX_PLUGINS);
+        return EXIT_FAILURE;
+      }
+      options.plugin_paths[options.num_plugins++] = argv[arg_index + 1];
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--expect") == 0 && arg_index + 1 < argc) {
+      options.expected_file_path = argv[arg_index + 1];
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--batch") == 0 && arg_index + 1 < argc) {
+      options.batch_file_path = argv[arg_index + 1];
+      arg_index += 2;
+      continue;
+    }
+    if (strcmp(argv[arg_index], "--cosim") == 0 && arg_index + 1 < argc) {
+      options.cosim_interval = parse_count(argv[arg_index], argv[arg_index + 1]);
+      arg_index += 2;
+      continue;
+    }
+    fprintf(stderr, "Unknown option %s\n", argv[arg_index]);
+    return EXIT_FAILURE;
+  }
+
+  bool profiling = options.profile_period > 0 || options.profile_timer_us > 0;
+  if (options.batch_file_path != NULL) {
+    if (options.timing || options.attach_gpio || options.cosim_interval > 0 || options.num_cores > 1
+        || profiling || options.num_plugins > 0 || options.expected_file_path != NULL) {
+      fprintf(stderr, "--batch cannot be combined with --timing, --gpio, --cosim, --cores, --profile, --plugin or --expect\n");
+      return EXIT_FAILURE;
+    }
+    if (arg_index != argc) {
+      perror("Too many arguments\n");
+      return EXIT_FAILURE;
+    }
+    return run_batch(options.batch_file_path, &options);
+  }
+
   //parsing the arguments
-  if (argc <= 1) {
+  int num_paths = argc - arg_index;
+  if (num_paths < 1) {
     perror("Not enough arguments\n");
     return EXIT_FAILURE;
   }
-  if (argc >= 4) {
+  if (num_paths > 2) {
     perror("Too many arguments\n");
     return EXIT_FAILURE;
   }
-   
-  const char *input_file_path;
-  const char *output_file_path;
 
-  if (argc == 2) {
-    input_file_path  = argv[1];
-    output_file_path = NULL;
-  } else {
-    input_file_path  = argv[1];
-    output_file_path = argv[2];
-  }
+  const char *input_file_path  = argv[arg_index];
+  const char *output_file_path = num_paths == 2 ? argv[arg_index + 1] : NULL;
 
-  emulate(input_file_path, output_file_path);
+  if (options.cosim_interval > 0 && (options.timing || options.attach_gpio)) {
+    fprintf(stderr, "--cosim cannot be combined with --timing or --gpio\n");
+    return EXIT_FAILURE;
+  }
+  if (options.num_cores > 1 && (options.timing || options.attach_gpio || options.cosim_interval > 0)) {
+    fprintf(stderr, "--cores cannot be combined with --timing, --gpio or --cosim\n");
+    return EXIT_FAILURE;
+  }
+  if (options.folded_file_path != NULL && !profiling) {
+    fprintf(stderr, "--profile-folded needs --profile or --profile-timer\n");
+    return EXIT_FAILURE;
+  }
+  if (profiling && (options.cosim_interval > 0 || options.num_cores > 1
+                    || (options.profile_period > 0 && (options.timing || options.profile_timer_us > 0)))) {
+    fprintf(stderr, "--profile cannot be combined with --cosim, --cores, --timing or --profile-timer\n");
+    return EXIT_FAILURE;
+  }
+  if (options.num_plugins > 0
+      && (options.timing || options.cosim_interval > 0 || options.num_cores > 1 || options.profile_period > 0)) {
+    fprintf(stderr, "--plugin cannot be combined with --timing, --cosim, --cores or --profile\n");
+    return EXIT_FAILURE;
+  }
+  if (options.expected_file_path != NULL && options.num_cores > 1) {
+    fprintf(stderr, "--expect cannot be combined with --cores\n");
+    return EXIT_FAILURE;
+  }
 
-  return EXIT_SUCCESS;
+  return emulate(input_file_path, output_file_path, &options);
 }
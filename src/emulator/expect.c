@@ -0,0 +1,172 @@
+/**
+ * @file expect.c
+ * @brief Checking the final state of the CPU against an expected output file.
+ *
+ * The expected state is parsed into a CpuSnapshot, with every unlisted memory word zero, so that
+ * checking it is a snapshot of the CPU and a comparison, as in co-simulation. Only when the two
+ * differ is the state walked word by word to report what differs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "expect.h"
+#include "cpu.h"
+#include "../fault.h"
+
+// Longest line of an expected output file, including the newline
+#define MAX_LINE_LENGTH 256
+
+// States compared by expect_check, kept in static storage since each holds a copy of memory
+static CpuSnapshot expected_state;    // State parsed by expect_load
+static CpuSnapshot actual_state;      // State of the CPU when it is checked
+
+/**
+ * @brief Checks whether the rest of a line is only whitespace.
+ */
+static bool only_whitespace(const char *text) {
+    while (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n') {
+        text++;
+    }
+    return *text == '\0';
+}
+
+/**
+ * @brief Parses the four characters of a PSTATE line, each a flag letter or '-'.
+ *
+ * @return true if the flags are well formed.
+ */
+static bool parse_pstate(const char *flags, processor_state *state) {
+    const char letters[] = "NZCV";
+    bool values[4];
+    for (int i = 0; i < 4; i++) {
+        if (flags[i] != letters[i] && flags[i] != '-') {
+            return false;
+        }
+        values[i] = flags[i] == letters[i];
+    }
+    *state = (processor_state) {values[0], values[1], values[2], values[3]};
+    return only_whitespace(flags + 4);
+}
+
+/**
+ * @brief Reads the expected final state from a file in the format of print_cpu.
+ *
+ * @param expected_file_path Path of the expected output file.
+ *
+ * @note A fault is raised if the file cannot be opened, has a line that is not part of the
+ *       format, lists a memory word outside memory, or lacks a register, PC or PSTATE line.
+ */
+void expect_load(const char *expected_file_path) {
+    FILE *expected_file = fopen(expected_file_path, "r");
+    if (expected_file == NULL) {
+        fault_raise("Failed to open expected output file %s\n", expected_file_path);
+    }
+
+    memset(&expected_state, 0, sizeof(expected_state));
+    uint64_t registers_seen = 0;
+    bool pc_seen = false, pstate_seen = false;
+
+    char line[MAX_LINE_LENGTH];
+    int line_number = 0;
+    while (fgets(line, MAX_LINE_LENGTH, expected_file) != NULL) {
+        line_number++;
+        int register_index, end = 0;
+        uint64_t value;
+        uint32_t address, data;
+
+        bool valid;
+        if (only_whitespace(line) || strcmp(line, "Registers:\n") == 0 || strcmp(line, "Non-Zero Memory:\n") == 0) {
+            valid = true;
+        } else if (sscanf(line, "X%d = %lx%n", &register_index, &value, &end) == 2 && only_whitespace(line + end)) {
+            valid = register_index >= 0 && register_index < NUM_REGISTERS;
+            if (valid) {
+                expected_state.registers[register_index] = value;
+                registers_seen |= 1ULL << register_index;
+            }
+        } else if (sscanf(line, "PC = %lx%n", &value, &end) == 1 && only_whitespace(line + end)) {
+            valid = true;
+            expected_state.program_counter = value;
+            pc_seen = true;
+        } else if (sscanf(line, "PSTATE : %n", &end) == 0 && end > 0) {
+            valid = parse_pstate(line + end, &expected_state.pstate);
+            pstate_seen = true;
+        } else if (sscanf(line, "0x%x: %x%n", &address, &data, &end) == 2 && only_whitespace(line + end)) {
+            valid = address % sizeof(word) == 0 && address <= NUM_OF_MEMORY_ADDRESS - sizeof(word);
+            if (valid) {
+                memcpy(expected_state.memory + address, &data, sizeof(word));
+            }
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            fclose(expected_file);
+            fault_raise("%s:%d: Not a line of emulator output\n", expected_file_path, line_number);
+        }
+    }
+    fclose(expected_file);
+
+    if (registers_seen != (1ULL << NUM_REGISTERS) - 1 || !pc_seen || !pstate_seen) {
+        fault_raise("%s: Missing a register, PC or PSTATE line\n", expected_file_path);
+    }
+}
+
+/**
+ * @brief Formats processor state flags as print_cpu does, into a buffer of at least 5 characters.
+ */
+static const char *pstate_text(processor_state state, char *text) {
+    text[0] = state.negative_flag ? 'N' : '-';
+    text[1] = state.zero_flag     ? 'Z' : '-';
+    text[2] = state.carry_flag    ? 'C' : '-';
+    text[3] = state.overflow_flag ? 'V' : '-';
+    text[4] = '\0';
+    return text;
+}
+
+/**
+ * @brief Compares the CPU's registers, PC, flags and memory with the state read by expect_load.
+ *
+ * Each register, flag or memory word that differs is written to the report as one line, starting
+ * with the label, and nothing is written if the states agree.
+ *
+ * @param report_file Stream to write the mismatches to.
+ * @param label Name of the program being checked, to start every line of the report with.
+ * @return The number of registers, flags and memory words that differ.
+ */
+int expect_check(FILE *report_file, const char *label) {
+    cpu_snapshot(&actual_state);
+    const CpuSnapshot *expected = &expected_state, *actual = &actual_state;
+    int mismatches = 0;
+
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        if (actual->registers[i] != expected->registers[i]) {
+            fprintf(report_file, "%s: X%02d: expected %016lx, found %016lx\n", label, i, expected->registers[i], actual->registers[i]);
+            mismatches++;
+        }
+    }
+    if (actual->program_counter != expected->program_counter) {
+        fprintf(report_file, "%s: PC: expected %016lx, found %016lx\n", label, expected->program_counter, actual->program_counter);
+        mismatches++;
+    }
+    if (memcmp(&actual->pstate, &expected->pstate, sizeof(processor_state)) != 0) {
+        char expected_flags[5], actual_flags[5];
+        fprintf(report_file, "%s: PSTATE: expected %s, found %s\n", label,
+                pstate_text(expected->pstate, expected_flags), pstate_text(actual->pstate, actual_flags));
+        mismatches++;
+    }
+
+    if (memcmp(actual->memory, expected->memory, NUM_OF_MEMORY_ADDRESS) == 0) {
+        return mismatches;
+    }
+    for (uint32_t address = 0; address < NUM_OF_MEMORY_ADDRESS; address += sizeof(word)) {
+        word expected_word, actual_word;
+        memcpy(&expected_word, expected->memory + address, sizeof(word));
+        memcpy(&actual_word, actual->memory + address, sizeof(word));
+        if (actual_word != expected_word) {
+            fprintf(report_file, "%s: 0x%08x: expected %08x, found %08x\n", label, address, expected_word, actual_word);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
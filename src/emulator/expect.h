@@ -0,0 +1,22 @@
+/**
+ * @file expect.h
+ * @brief Header file for checking the final state of the CPU against an expected output file.
+ * @details The expected file is in the format print_cpu writes: the registers, PC, PSTATE and
+ *          non-zero memory words. It is parsed once, and the CPU's state is then compared with it
+ *          directly, which spares a regression run from writing its own output and running diff.
+ *          Every register, PC and PSTATE line must be present, and any memory word the file does
+ *          not list is expected to be zero. Blank lines and the section headers are ignored.
+ */
+
+#ifndef EXPECT_H
+#define EXPECT_H
+
+#include <stdio.h>
+
+// Reads the expected final state from a file in the format of print_cpu, raising a fault if it is malformed
+extern void expect_load(const char *expected_file_path);
+
+// Compares the CPU's state with the expected state, reporting each mismatch; returns the number of mismatches
+extern int expect_check(FILE *report_file, const char *label);
+
+#endif /* EXPECT_H */
@@ -0,0 +1,127 @@
+/**
+ * @file gpio.c
+ * @brief Emulated GPIO controller of a Raspberry Pi 3.
+ *
+ * Models the registers led_blink.s and similar kernels use:
+ * - GPFSEL0-5 select the function of each pin, three bits per pin, where 001 makes it an output.
+ * - GPSET0-1 drive the pins whose bits are written as 1 high.
+ * - GPCLR0-1 drive the pins whose bits are written as 1 low.
+ * - GPLEV0-1 read back the current level of every pin.
+ *
+ * Whenever the level of a pin selected as an output changes, a line giving the pin, its new level
+ * and the number of instructions executed so far is written to the log. Other registers read as
+ * zero and ignore writes.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "gpio.h"
+#include "cpu.h"
+#include "memory.h"
+
+// Register offsets from GPIO_BASE_ADDRESS
+#define GPFSEL0 0x00
+#define GPFSEL5 0x14
+#define GPSET0 0x1c
+#define GPSET1 0x20
+#define GPCLR0 0x28
+#define GPCLR1 0x2c
+#define GPLEV0 0x34
+#define GPLEV1 0x38
+
+#define PINS_PER_FSEL 10
+#define FSEL_BITS 3
+#define FSEL_MASK 0x7
+#define FSEL_OUTPUT 0x1
+#define PINS_PER_BANK 32
+
+// State of the GPIO controller
+typedef struct {
+    word fsel[GPFSEL5 / sizeof(word) + 1];   // Function select registers
+    uint64_t levels;                         // Level of every pin, one bit per pin
+    FILE *log_file;                          // Stream pin changes are logged to
+} Gpio;
+
+static Gpio gpio;
+
+/**
+ * @brief Checks whether a pin has been selected as an output.
+ */
+static bool is_output(int pin) {
+    word fsel = gpio.fsel[pin / PINS_PER_FSEL];
+    return (fsel >> (pin % PINS_PER_FSEL * FSEL_BITS) & FSEL_MASK) == FSEL_OUTPUT;
+}
+
+/**
+ * @brief Drives pins high or low, logging every output pin whose level changes.
+ *
+ * @param pins Pins to drive, one bit per pin.
+ * @param high true to drive the pins high, false to drive them low.
+ */
+static void drive_pins(uint64_t pins, bool high) {
+    pins &= (1ULL << GPIO_NUM_PINS) - 1;
+    uint64_t new_levels = high ? gpio.levels | pins : gpio.levels & ~pins;
+    uint64_t changed = new_levels ^ gpio.levels;
+    gpio.levels = new_levels;
+
+    for (int pin = 0; pin < GPIO_NUM_PINS && changed != 0; pin++, changed >>= 1) {
+        if ((changed & 1) && is_output(pin)) {
+            fprintf(gpio.log_file, "GPIO pin %d %s after %lu instructions\n",
+                    pin, high ? "on" : "off", get_instruction_count());
+        }
+    }
+}
+
+/**
+ * @brief Device read callback for the GPIO registers.
+ */
+static word gpio_read(void *state, uint32_t offset) {
+    if (offset <= GPFSEL5 && offset % sizeof(word) == 0) {
+        return gpio.fsel[offset / sizeof(word)];
+    }
+    switch (offset) {
+        case GPLEV0:
+            return (word) gpio.levels;
+        case GPLEV1:
+            return (word) (gpio.levels >> PINS_PER_BANK);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Device write callback for the GPIO registers.
+ */
+static void gpio_write(void *state, uint32_t offset, word data) {
+    if (offset <= GPFSEL5 && offset % sizeof(word) == 0) {
+        gpio.fsel[offset / sizeof(word)] = data;
+        return;
+    }
+    switch (offset) {
+        case GPSET0:
+            drive_pins(data, true);
+            break;
+        case GPSET1:
+            drive_pins((uint64_t) data << PINS_PER_BANK, true);
+            break;
+        case GPCLR0:
+            drive_pins(data, false);
+            break;
+        case GPCLR1:
+            drive_pins((uint64_t) data << PINS_PER_BANK, false);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Attaches the GPIO controller to memory at GPIO_BASE_ADDRESS, with every pin an input and low.
+ *
+ * @param log_file Stream that changes in the level of output pins are written to.
+ */
+void gpio_attach(FILE *log_file) {
+    gpio = (Gpio) {.log_file = log_file};
+    memory_register_device(GPIO_BASE_ADDRESS, GPIO_SIZE, gpio_read, gpio_write, &gpio);
+}
@@ -0,0 +1,25 @@
+/**
+ * @file gpio.h
+ * @brief Header file for the emulated GPIO controller of a Raspberry Pi 3.
+ *
+ * The controller is attached to memory at the address the Pi 3 maps it to, so kernels such as
+ * led_blink.s that drive the GPIO pins can be run under the emulator. Every change in the level
+ * of an output pin is logged.
+ */
+
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <stdio.h>
+
+// Physical address of the GPIO controller on a Raspberry Pi 3
+#define GPIO_BASE_ADDRESS 0x3f200000
+// Number of bytes of registers the controller occupies
+#define GPIO_SIZE 0xb4
+// Number of GPIO pins
+#define GPIO_NUM_PINS 54
+
+// Attaches the GPIO controller to memory, logging pin changes to the given stream.
+extern void gpio_attach(FILE *log_file);
+
+#endif /* GPIO_H */
@@ -8,30 +8,305 @@
  * Functions:
  * - init_memory: Initializes memory by setting all addresses to zero.
  * - load_instructions_to_memory: Loads instructions from a file into memory.
+ * - load_instructions_to_memory_buffer: Loads instructions from a buffer of words into memory.
  * - get_word: Retrieves a word from a specified memory address.
  * - set_word: Sets a word at a specified memory address.
  * - get_double_word: Retrieves a double word from a specified memory address.
  * - set_double_word: Sets a double word at a specified memory address.
- * - print_memory: Prints non-zero memory contents to a specified output file.
+ * - format_memory: Formats the non-zero memory contents into an output buffer.
+ * - memory_register_device: Attaches read and write callbacks to a range of addresses outside RAM.
+ * - memory_clear_devices: Detaches every device.
+ * - memory_set_observer: Sets a callback told about every data access, used by the timing model.
+ * - get_instruction: Retrieves an instruction word without notifying the observer.
+ * - memory_track_writes: Turns on or off the tracking of which pages of RAM have been written.
+ * - memory_snapshot / memory_restore: Copy the whole of RAM out to or back in from a buffer.
+ *
+ * While write tracking is on, every store to RAM, and every program loaded into it, marks the
+ * pages it touches as written. Clearing memory, taking a snapshot and restoring one then only touch
+ * the written pages, which for most programs are a few of the 512. Tracking is for callers that
+ * reset or copy memory often, such as the server and batch mode, so it is off by default and every
+ * page counts as written; turning it on sends stores down the checked path, as the observer does.
+ *
+ * Accesses within RAM never look at the devices. Only an access that would otherwise be out of
+ * bounds searches the (short) list of devices, so devices add no cost to ordinary loads and stores.
+ * The observer costs nothing while it is unset either: attaching it lowers the bound that the fast
+ * path compares against to 0, so the one bounds check sends every access down the checked path.
+ *
+ * When built with MEMORY_GUARD_PAGES, RAM sits at the start of a reservation covering every 32-bit
+ * address, and everything past RAM is mapped without access. Loads and stores then skip the bounds
+ * check and go straight to the host, and an out of bounds access is caught by a SIGSEGV handler
+ * that raises the usual fault. The checked path is still taken while an observer or a device is
+ * attached, as those need to see accesses before they happen, and by an access that straddles the
+ * end of RAM, which would otherwise write its first bytes before reaching the guard pages.
+ *
+ * RAM is shared by every core run by smp_run. Aligned loads and stores of a word or double word
+ * are single-copy atomic, so a core never sees another core's store half done (see smp.h).
  */
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef MEMORY_GUARD_PAGES
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "memory.h"
+#include "../fault.h"
+#include "../output_buffer.h"
 
 // Size of an instruction in bytes.
 #define INSTR_SIZE 4
 
+// Maximum number of devices that can be attached at once.
+#define MAX_DEVICES 8
+
+// A memory mapped device occupying the addresses [base, base + size).
+typedef struct {
+    uint32_t base;
+    uint32_t size;
+    DeviceRead read;
+    DeviceWrite write;
+    void *state;
+} Device;
+
+#ifdef MEMORY_GUARD_PAGES
+// Bytes reserved for memory: a double word at any 32-bit address lies within the reservation.
+#define RESERVED_SIZE (((size_t) 1 << 32) + sizeof(double_word))
+
+// Start of the reservation, whose first NUM_OF_MEMORY_ADDRESS bytes are RAM.
+static uint8_t *mem;
+#else
 // Array representing memory.
-static uint8_t mem[NUM_OF_MEMORY_ADDRESS];
+static _Alignas(sizeof(double_word)) uint8_t mem[NUM_OF_MEMORY_ADDRESS];
+#endif
+
+// Pages of RAM that have been loaded or written since memory was last cleared, and so may be non-zero.
+// Only kept up to date while tracking is set. Cores mark pages with relaxed atomic stores, as
+// several may write to the same page at once.
+static uint8_t written_pages[NUM_MEMORY_PAGES];
+
+// Whether stores mark the pages they write in written_pages.
+static bool tracking;
+
+// Whether a page of RAM may be non-zero, which any page may be while writes are not tracked
+static inline bool page_written(int page) {
+    return !tracking || written_pages[page];
+}
+
+// Marks the pages holding an access that has just been made to RAM as written
+static inline void mark_written(const uint8_t *location, size_t length) {
+    size_t address = location - mem;
+    __atomic_store_n(&written_pages[address / MEMORY_PAGE_SIZE], 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&written_pages[(address + length - 1) / MEMORY_PAGE_SIZE], 1, __ATOMIC_RELAXED);
+}
+
+// Marks every page of a range of RAM as written
+static void mark_range_written(uint32_t address, size_t length) {
+    if (length == 0) {
+        return;
+    }
+    for (size_t page = address / MEMORY_PAGE_SIZE; page <= (address + length - 1) / MEMORY_PAGE_SIZE; page++) {
+        written_pages[page] = 1;
+    }
+}
+
+// Copies bytes out of RAM one relaxed atomic byte load at a time, so that an unaligned access
+// racing with another core is not a data race, though it may see a mix of old and new bytes
+static inline void load_bytes(const uint8_t *location, void *data, size_t length) {
+    uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        bytes[i] = __atomic_load_n(&location[i], __ATOMIC_RELAXED);
+    }
+}
+
+// Copies bytes into RAM one relaxed atomic byte store at a time, the counterpart of load_bytes
+static inline void store_bytes(uint8_t *location, const void *data, size_t length) {
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < length; i++) {
+        __atomic_store_n(&location[i], bytes[i], __ATOMIC_RELAXED);
+    }
+}
+
+// Loads a word from RAM, as one atomic access if it is aligned
+static inline word load_word(const uint8_t *location) {
+    if (((uintptr_t) location & (sizeof(word) - 1)) == 0) {
+        return __atomic_load_n((const word *) location, __ATOMIC_RELAXED);
+    }
+    word data;
+    load_bytes(location, &data, sizeof(word));
+    return data;
+}
+
+// Stores a word to RAM, as one atomic access if it is aligned
+static inline void store_word(uint8_t *location, word data) {
+    if (((uintptr_t) location & (sizeof(word) - 1)) == 0) {
+        __atomic_store_n((word *) location, data, __ATOMIC_RELAXED);
+    } else {
+        store_bytes(location, &data, sizeof(word));
+    }
+}
+
+// Loads a double word from RAM, as one atomic access if it is aligned
+static inline double_word load_double_word(const uint8_t *location) {
+    if (((uintptr_t) location & (sizeof(double_word) - 1)) == 0) {
+        return __atomic_load_n((const double_word *) location, __ATOMIC_RELAXED);
+    }
+    double_word data;
+    load_bytes(location, &data, sizeof(double_word));
+    return data;
+}
+
+// Stores a double word to RAM, as one atomic access if it is aligned
+static inline void store_double_word(uint8_t *location, double_word data) {
+    if (((uintptr_t) location & (sizeof(double_word) - 1)) == 0) {
+        __atomic_store_n((double_word *) location, data, __ATOMIC_RELAXED);
+    } else {
+        store_bytes(location, &data, sizeof(double_word));
+    }
+}
+
+// Devices attached outside of RAM, searched only by out of bounds accesses.
+static Device devices[MAX_DEVICES];
+static int num_devices;
+
+// Callback told about every data access, or NULL.
+static MemoryObserver observer;
+
+// Whether an observer or a device is attached, so that accesses must take the checked path.
+static bool checked;
+
+// Whether stores must take the checked path, because accesses are checked or writes are tracked.
+static bool store_checked;
 
-// Initializes memory by setting all addresses to zero.
+#ifndef MEMORY_GUARD_PAGES
+// A word or double word access at an address below these goes straight to RAM. They are 0 while
+// checked is set, so that the bounds check also sends every access to the observer, at no cost
+// to runs without one. The store bounds are also 0 while writes are tracked.
+static uint32_t word_fast_end = NUM_OF_MEMORY_ADDRESS - sizeof(word) + 1;
+static uint32_t double_word_fast_end = NUM_OF_MEMORY_ADDRESS - sizeof(double_word) + 1;
+static uint32_t word_store_fast_end = NUM_OF_MEMORY_ADDRESS - sizeof(word) + 1;
+static uint32_t double_word_store_fast_end = NUM_OF_MEMORY_ADDRESS - sizeof(double_word) + 1;
+#endif
+
+// Updates checked after an observer or a device has been attached or detached, or tracking changed.
+static void update_checked(void) {
+    checked = observer != NULL || num_devices > 0;
+    store_checked = checked || tracking;
+#ifndef MEMORY_GUARD_PAGES
+    word_fast_end = checked ? 0 : NUM_OF_MEMORY_ADDRESS - sizeof(word) + 1;
+    double_word_fast_end = checked ? 0 : NUM_OF_MEMORY_ADDRESS - sizeof(double_word) + 1;
+    word_store_fast_end = store_checked ? 0 : NUM_OF_MEMORY_ADDRESS - sizeof(word) + 1;
+    double_word_store_fast_end = store_checked ? 0 : NUM_OF_MEMORY_ADDRESS - sizeof(double_word) + 1;
+#endif
+}
+
+#ifdef MEMORY_GUARD_PAGES
+// Whether an access of a number of bytes at an address starts in RAM but ends past it
+#define STRADDLES_END(address, length) ((uint32_t) ((address) - (NUM_OF_MEMORY_ADDRESS - (length) + 1)) < (length) - 1)
+
+// Whether an access at an address can go straight to RAM, leaving the guard pages to catch it if it is out of bounds.
+// One that straddles the end of RAM takes the checked path, so that a store faults before writing its first bytes.
+#define FAST_WORD(address) (!checked && !STRADDLES_END(address, sizeof(word)))
+#define FAST_DOUBLE_WORD(address) (!checked && !STRADDLES_END(address, sizeof(double_word)))
+#define FAST_STORE_WORD(address) (!store_checked && !STRADDLES_END(address, sizeof(word)))
+#define FAST_STORE_DOUBLE_WORD(address) (!store_checked && !STRADDLES_END(address, sizeof(double_word)))
+#else
+// Whether an access at an address can go straight to RAM, being in bounds with nothing attached
+#define FAST_WORD(address) ((address) < word_fast_end)
+#define FAST_DOUBLE_WORD(address) ((address) < double_word_fast_end)
+#define FAST_STORE_WORD(address) ((address) < word_store_fast_end)
+#define FAST_STORE_DOUBLE_WORD(address) ((address) < double_word_store_fast_end)
+#endif
+
+#ifdef MEMORY_GUARD_PAGES
+/**
+ * @brief Handles a segmentation fault, raising an out of bounds fault if it was an emulated access.
+ *
+ * The handler is installed with SA_NODEFER, so leaving it through the fault handler's longjmp
+ * does not leave SIGSEGV blocked.
+ */
+static void handle_segv(int signal_number, siginfo_t *info, void *context) {
+    uint8_t *host_address = info->si_addr;
+    if (host_address < mem || host_address >= mem + RESERVED_SIZE) {
+        // A bug in the emulator rather than the program, so crash as usual once this returns
+        signal(SIGSEGV, SIG_DFL);
+        return;
+    }
+    uint32_t address = host_address - mem;
+    if (fault_handled()) {
+        fault_raise("Out of bounds trying to access memory address 0x%x\n", address);
+    }
+
+    // With nowhere to return to, report and exit using only async-signal-safe calls
+    static const char prefix[] = "Out of bounds trying to access memory address 0x";
+    char digits[2 * sizeof(address) + 1];
+    char *digit = digits + sizeof(digits);
+    *--digit = '\n';
+    do {
+        *--digit = "0123456789abcdef"[address & 0xf];
+        address >>= 4;
+    } while (address != 0);
+    write(STDERR_FILENO, prefix, sizeof(prefix) - 1);
+    write(STDERR_FILENO, digit, digits + sizeof(digits) - digit);
+    _exit(EXIT_FAILURE);
+}
+
+/**
+ * @brief Reserves the address space for memory and makes RAM accessible.
+ *
+ * @note The function exits the program with a failure status if the address space cannot be reserved.
+ */
+static void reserve_memory(void) {
+    mem = mmap(NULL, RESERVED_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED || mprotect(mem, NUM_OF_MEMORY_ADDRESS, PROT_READ | PROT_WRITE) == -1) {
+        perror("Failed to reserve memory");
+        exit(EXIT_FAILURE);
+    }
+
+    struct sigaction action = {.sa_sigaction = handle_segv, .sa_flags = SA_SIGINFO | SA_NODEFER};
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGSEGV, &action, NULL);
+}
+#endif
+
+/**
+ * @brief Initializes memory by setting all addresses to zero.
+ *
+ * While writes are tracked, only the pages loaded or written since memory was last cleared are
+ * cleared, so resetting after a small program costs little however large memory is.
+ */
 void init_memory(void) {
-    for (int i = 0; i < NUM_OF_MEMORY_ADDRESS; i++) {
-        mem[i] = 0;
+#ifdef MEMORY_GUARD_PAGES
+    if (mem == NULL) {
+        reserve_memory(); // A fresh mapping is already zeroed
+        return;
+    }
+#endif
+    for (int page = 0; page < NUM_MEMORY_PAGES; page++) {
+        if (page_written(page)) {
+            memset(mem + page * MEMORY_PAGE_SIZE, 0, MEMORY_PAGE_SIZE);
+            written_pages[page] = 0;
+        }
+    }
+}
+
+/**
+ * @brief Turns on or off the tracking of which pages of RAM have been written.
+ *
+ * While tracking is on, stores take the checked path so that they can mark their pages. Turning
+ * it on counts every page as written until memory is next cleared, as RAM may hold anything.
+ *
+ * @param enabled Whether to track written pages.
+ */
+void memory_track_writes(bool enabled) {
+    if (enabled && !tracking) {
+        memset(written_pages, 1, sizeof(written_pages));
     }
+    tracking = enabled;
+    update_checked();
 }
 
 /**
@@ -45,9 +320,10 @@ void init_memory(void) {
  *
  * @param input_file Pointer to the input file containing instructions to be loaded.
  *
- * @note The function exits the program with a failure status if:
+ * @note The function raises a fault if:
  * - The input file size exceeds the memory capacity (`NUM_OF_MEMORY_ADDRESS`).
  * - An error occurs while reading from the input file.
+ * The caller still owns the file and closes it either way.
  */
 void load_instructions_to_memory(FILE* input_file) {
     //determine the file size
@@ -58,32 +334,33 @@ void load_instructions_to_memory(FILE* input_file) {
     const int num_of_instructions = file_size / INSTR_SIZE; 
 
     if (file_size > NUM_OF_MEMORY_ADDRESS) {
-        perror("Input file size too large for memory\n");
-        exit(EXIT_FAILURE);
+        fault_raise("Input file size too large for memory\n");
     }
     
-    // Write the content of the file to memory array
+    // Write the content of the file to memory array, marking it first in case reading fails part way
+    mark_range_written(0, num_of_instructions * INSTR_SIZE);
     for (int i = 0; i < num_of_instructions; i++) {
         int result = fread(mem + i * INSTR_SIZE, INSTR_SIZE, 1, input_file);
 
         // Error if reads more or less than 1 element
         if (result != 1) {
-            perror("Failed to read from file input file\n");
-            fclose(input_file);
-            exit(EXIT_FAILURE);
+            fault_raise("Failed to read from input file\n");
         }
     }
 }
 
+/**
+ * @brief Loads instructions from an array of words into memory.
+ *
+ * @param input_data Array of the instructions (uint32_t *) to load.
+ *
+ * @note The function raises a fault if the instructions do not fit in memory.
+ */
 void load_instructions_to_memory_array(DArray* input_data) {
-    // Calculate the number of instructions
-    int data_size = darray_length(input_data);
-    const int num_of_instructions = data_size;
+    const int num_of_instructions = darray_length(input_data);
 
-    // Check if the data size exceeds memory size
-    if (data_size > NUM_OF_MEMORY_ADDRESS) {
-        perror("Input data size too large for memory\n");
-        exit(EXIT_FAILURE);
+    if (num_of_instructions > NUM_OF_MEMORY_ADDRESS / INSTR_SIZE) {
+        fault_raise("Input data size too large for memory\n");
     }
 
     // Write the content of the input_data array to memory array
@@ -91,42 +368,173 @@ void load_instructions_to_memory_array(DArray* input_data) {
         // Copy the instruction to memory
         memcpy(mem + i * INSTR_SIZE, darray_get(input_data, i), INSTR_SIZE);
     }
+    mark_range_written(0, num_of_instructions * INSTR_SIZE);
 }
 
 /**
- * @brief Retrieves a word from the specified memory address.
+ * @brief Loads instructions from a buffer of words into memory.
  *
- * @param address The memory address from which to retrieve the word.
+ * @param instructions Buffer holding the instructions to load.
+ * @param num_of_instructions Number of instructions in the buffer.
+ *
+ * @note The function raises a fault if the instructions do not fit in memory.
+ */
+void load_instructions_to_memory_buffer(const word *instructions, size_t num_of_instructions) {
+    if (num_of_instructions > NUM_OF_MEMORY_ADDRESS / INSTR_SIZE) {
+        fault_raise("Input data size too large for memory\n");
+    }
+
+    memcpy(mem, instructions, num_of_instructions * INSTR_SIZE);
+    mark_range_written(0, num_of_instructions * INSTR_SIZE);
+}
+
+/**
+ * @brief Attaches a memory mapped device to a range of addresses outside RAM.
+ *
+ * Word and double word accesses that fall entirely within the range are passed to the device's
+ * callbacks as word accesses at offsets from the base of the range; a double word access is split
+ * into its low word followed by its high word.
+ *
+ * @param base First address of the range.
+ * @param size Number of bytes in the range.
+ * @param read Callback for reads from the range.
+ * @param write Callback for writes to the range.
+ * @param state Pointer passed back to the callbacks.
+ *
+ * @note The function exits the program with a failure status if the range overlaps RAM or
+ *       another device, or if too many devices are attached.
+ */
+void memory_register_device(uint32_t base, uint32_t size, DeviceRead read, DeviceWrite write, void *state) {
+    if (base < NUM_OF_MEMORY_ADDRESS || size == 0 || base + size - 1 < base) {
+        fprintf(stderr, "Device at 0x%x must lie outside of memory\n", base);
+        exit(EXIT_FAILURE);
+    }
+    if (num_devices == MAX_DEVICES) {
+        fprintf(stderr, "Too many devices attached to memory\n");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < num_devices; i++) {
+        if (base <= devices[i].base + (devices[i].size - 1) && devices[i].base <= base + (size - 1)) {
+            fprintf(stderr, "Device at 0x%x overlaps device at 0x%x\n", base, devices[i].base);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    devices[num_devices++] = (Device) {base, size, read, write, state};
+    update_checked();
+}
+
+// Detaches every device.
+void memory_clear_devices(void) {
+    num_devices = 0;
+    update_checked();
+}
+
+/**
+ * @brief Finds the device that an out of bounds access falls entirely within.
+ *
+ * @param address First address of the access.
+ * @param length Number of bytes accessed.
+ * @return The device, or NULL if there is none.
+ */
+static Device *find_device(uint32_t address, uint32_t length) {
+    for (int i = 0; i < num_devices; i++) {
+        if (address >= devices[i].base && address - devices[i].base <= devices[i].size - length) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+// Sets the callback told about every data access, or NULL for none.
+void memory_set_observer(MemoryObserver new_observer) {
+    observer = new_observer;
+    update_checked();
+}
+
+/**
+ * @brief Reads a word that cannot take the fast path: one seen by the observer, in a device or out of bounds.
+ *
+ * @param address The memory address from which to read the word.
+ * @param observed Whether the observer is told about the read (false for instruction fetches).
  * @return The 32-bit word read from the specified memory address.
  *
- * @note The function exits the program with a failure status if the address is out of bounds.
+ * @note The function raises a fault if the address is out of bounds
+ *       and not within a device.
  */
-word get_word(uint32_t address) {
+static word read_word_checked(uint32_t address, bool observed) {
+    if (observed && observer != NULL) {
+        observer(address, sizeof(word), false);
+    }
     if (address > NUM_OF_MEMORY_ADDRESS - sizeof(word)) {
-        fprintf(stderr, "Out of bounds trying to access word from memory address 0x%x\n", address);
-        exit(EXIT_FAILURE);
+        Device *device = find_device(address, sizeof(word));
+        if (device != NULL) {
+            return device->read(device->state, address - device->base);
+        }
+        fault_raise("Out of bounds trying to access word from memory address 0x%x\n", address);
     }
 
-    word data;
-    memcpy(&data, mem + address, sizeof(word));
-    return data;
+    return load_word(mem + address);
 }
 
 /**
- * @brief Retrieves a word (32-bit) from the specified memory address.
+ * @brief Retrieves a word from the specified memory address as data.
  *
  * @param address The memory address from which to retrieve the word.
  * @return The 32-bit word read from the specified memory address.
+ */
+word get_word(uint32_t address) {
+    if (FAST_WORD(address)) {
+        return load_word(mem + address);
+    }
+    return read_word_checked(address, true);
+}
+
+/**
+ * @brief Retrieves the instruction at the specified memory address.
+ *
+ * This is get_word for instruction fetches, which the observer is not told about.
  *
- * @note The function exits the program with a failure status if the address is out of bounds.
+ * @param address The memory address from which to retrieve the instruction.
+ * @return The instruction read from the specified memory address.
+ */
+word get_instruction(uint32_t address) {
+    if (FAST_WORD(address)) {
+        return load_word(mem + address);
+    }
+    return read_word_checked(address, false);
+}
+
+/**
+ * @brief Sets a word (32-bit) at the specified memory address.
+ *
+ * @param address The memory address at which to set the word.
+ * @param data The 32-bit word to write to the specified memory address.
+ *
+ * @note The function raises a fault if the address is out of bounds
+ *       and not within a device.
  */
 void set_word(uint32_t address, word data) {
+    if (FAST_STORE_WORD(address)) {
+        store_word(mem + address, data);
+        return;
+    }
+    if (observer != NULL) {
+        observer(address, sizeof(word), true);
+    }
     if (address > NUM_OF_MEMORY_ADDRESS - sizeof(word)) {
-        fprintf(stderr, "Out of bounds trying to access word from memory address 0x%x\n", address);
-        exit(EXIT_FAILURE);
+        Device *device = find_device(address, sizeof(word));
+        if (device != NULL) {
+            device->write(device->state, address - device->base, data);
+            return;
+        }
+        fault_raise("Out of bounds trying to access word from memory address 0x%x\n", address);
     }
 
-    memcpy(mem + address, &data, sizeof(word));
+    store_word(mem + address, data);
+    if (tracking) {
+        mark_written(mem + address, sizeof(word));
+    }
 }
 
 /**
@@ -135,17 +543,28 @@ void set_word(uint32_t address, word data) {
  * @param address The memory address from which to retrieve the double word.
  * @return The 64-bit double word read from the specified memory address.
  *
- * @note The function exits the program with a failure status if the address is out of bounds.
+ * @note The function raises a fault if the address is out of bounds
+ *       and not within a device.
  */
 double_word get_double_word(uint32_t address) {
+    if (FAST_DOUBLE_WORD(address)) {
+        return load_double_word(mem + address);
+    }
+    if (observer != NULL) {
+        observer(address, sizeof(double_word), false);
+    }
     if (address > NUM_OF_MEMORY_ADDRESS - sizeof(double_word)) {
-        fprintf(stderr, "Out of bounds trying to access double word from memory address 0x%x\n", address);
-        exit(EXIT_FAILURE);
+        Device *device = find_device(address, sizeof(double_word));
+        if (device != NULL) {
+            uint32_t offset = address - device->base;
+            double_word low = device->read(device->state, offset);
+            double_word high = device->read(device->state, offset + sizeof(word));
+            return high << 32 | low;
+        }
+        fault_raise("Out of bounds trying to access double word from memory address 0x%x\n", address);
     }
 
-    double_word data;
-    memcpy(&data, mem + address, sizeof(double_word));
-    return data;
+    return load_double_word(mem + address);
 }
 
 /**
@@ -154,29 +573,99 @@ double_word get_double_word(uint32_t address) {
  * @param address The memory address at which to set the double word.
  * @param data The 64-bit double word to write to the specified memory address.
  * 
- * @note The function exits the program with a failure status if the address is out of bounds.
+ * @note The function raises a fault if the address is out of bounds
+ *       and not within a device.
  */
 void set_double_word(uint32_t address, double_word data) {
+    if (FAST_STORE_DOUBLE_WORD(address)) {
+        store_double_word(mem + address, data);
+        return;
+    }
+    if (observer != NULL) {
+        observer(address, sizeof(double_word), true);
+    }
     if (address > NUM_OF_MEMORY_ADDRESS - sizeof(double_word)) {
-        fprintf(stderr, "Out of bounds trying to access double word from memory address 0x%x\n", address);
-        exit(EXIT_FAILURE);
+        Device *device = find_device(address, sizeof(double_word));
+        if (device != NULL) {
+            uint32_t offset = address - device->base;
+            device->write(device->state, offset, (word) data);
+            device->write(device->state, offset + sizeof(word), (word) (data >> 32));
+            return;
+        }
+        fault_raise("Out of bounds trying to access double word from memory address 0x%x\n", address);
     }
 
-    memcpy(mem + address, &data, sizeof(double_word));
+    store_double_word(mem + address, data);
+    if (tracking) {
+        mark_written(mem + address, sizeof(double_word));
+    }
 }
 
 /**
- * @brief Prints the non-zero memory contents to the specified output file.
+ * @brief Copies the whole of RAM into a buffer.
  *
- * This is used when printing out the final output in the ".out" file, as specified by the specification
+ * The buffer's page map says which of its pages may be non-zero, and every other page of it is
+ * zero. Only pages written in RAM are copied (every page, unless writes are tracked), and pages left over from an earlier snapshot that
+ * are no longer written in RAM are cleared, so the cost follows the memory the program touches.
  *
- * @param output_file Pointer to the file where the memory contents will be printed.
+ * @param buffer Buffer of NUM_OF_MEMORY_ADDRESS bytes, zeroed or holding an earlier snapshot.
+ * @param buffer_pages Page map of the buffer, NUM_MEMORY_PAGES bytes, zeroed or from the same earlier snapshot.
  */
-void print_memory(FILE* output_file) {
-    fprintf(output_file, "Non-Zero Memory:\n");
-    for (int i = 0; i < NUM_OF_MEMORY_ADDRESS; i += 4) {
-        if (get_word(i) != 0) {
-            fprintf(output_file, "0x%08x: %08x\n", i, get_word(i));
+void memory_snapshot(uint8_t *buffer, uint8_t *buffer_pages) {
+    for (int page = 0; page < NUM_MEMORY_PAGES; page++) {
+        size_t offset = (size_t) page * MEMORY_PAGE_SIZE;
+        if (page_written(page)) {
+            memcpy(buffer + offset, mem + offset, MEMORY_PAGE_SIZE);
+        } else if (buffer_pages[page]) {
+            memset(buffer + offset, 0, MEMORY_PAGE_SIZE);
+        }
+        buffer_pages[page] = page_written(page);
+    }
+}
+
+/**
+ * @brief Replaces the whole of RAM with the contents of a buffer.
+ *
+ * As with memory_snapshot, only the pages written in the buffer or in RAM are touched.
+ *
+ * @param buffer Buffer of NUM_OF_MEMORY_ADDRESS bytes, as filled by memory_snapshot.
+ * @param buffer_pages Page map of the buffer, as filled by memory_snapshot.
+ */
+void memory_restore(const uint8_t *buffer, const uint8_t *buffer_pages) {
+    for (int page = 0; page < NUM_MEMORY_PAGES; page++) {
+        size_t offset = (size_t) page * MEMORY_PAGE_SIZE;
+        if (buffer_pages[page]) {
+            memcpy(mem + offset, buffer + offset, MEMORY_PAGE_SIZE);
+        } else if (page_written(page)) {
+            memset(mem + offset, 0, MEMORY_PAGE_SIZE);
+        }
+        written_pages[page] = buffer_pages[page];
+    }
+}
+
+/**
+ * @brief Formats the non-zero memory contents into an output buffer.
+ *
+ * This is used when printing out the final output in the ".out" file, as specified by the specification.
+ * Each non-zero word is formatted as "0x%08x: %08x\n" would format it.
+ *
+ * @param ob The output buffer to append the memory contents to.
+ */
+void format_memory(OutputBuffer *ob) {
+    output_buffer_append(ob, "Non-Zero Memory:\n");
+    for (uint32_t address = 0; address < NUM_OF_MEMORY_ADDRESS; address += sizeof(word)) {
+        // Pages that have never been written are all zero
+        if (!page_written(address / MEMORY_PAGE_SIZE)) {
+            address += MEMORY_PAGE_SIZE - sizeof(word);
+            continue;
+        }
+        word data = load_word(mem + address);
+        if (data != 0) {
+            output_buffer_append(ob, "0x");
+            output_buffer_append_hex(ob, address, 8);
+            output_buffer_append(ob, ": ");
+            output_buffer_append_hex(ob, data, 8);
+            output_buffer_append(ob, "\n");
         }
     }
 }
@@ -10,15 +10,29 @@
 #ifndef MEMORY_H
 #define MEMORY_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #include "../ADTs/darray.h"
+#include "../output_buffer.h"
 
 #define NUM_OF_MEMORY_ADDRESS (1 << 21)
+// Size of the pages of RAM whose writes are tracked, so that only written pages are cleared or copied
+#define MEMORY_PAGE_SIZE 4096
+#define NUM_MEMORY_PAGES (NUM_OF_MEMORY_ADDRESS / MEMORY_PAGE_SIZE)
 
 typedef uint32_t word;
 typedef uint64_t double_word;
 
+// Callback reading a word from a device at an offset from the start of its address range.
+typedef word (*DeviceRead)(void *state, uint32_t offset);
+// Callback writing a word to a device at an offset from the start of its address range.
+typedef void (*DeviceWrite)(void *state, uint32_t offset, word data);
+// Callback told about a data access of the given number of bytes, before it is made.
+typedef void (*MemoryObserver)(uint32_t address, uint32_t length, bool is_write);
+
 // Initializes memory to zero.
 extern void init_memory(void); 
 
@@ -28,8 +42,13 @@ extern void load_instructions_to_memory(FILE* input_file);
 // Loads instructions from a file into memory using an array.
 extern void load_instructions_to_memory_array(DArray* input_data);
 
+// Loads instructions into memory from a buffer of words.
+extern void load_instructions_to_memory_buffer(const word *instructions, size_t num_of_instructions);
+
 // Retrieves a word from the specified memory address.
 extern word get_word(uint32_t address);
+// Retrieves an instruction from the specified memory address, without notifying the observer.
+extern word get_instruction(uint32_t address);
 // Sets a word at the specified memory address.
 extern void set_word(uint32_t address, word data);
 
@@ -38,7 +57,24 @@ extern double_word get_double_word(uint32_t address);
 // Sets a double word at the specified memory address.
 extern void set_double_word(uint32_t address, double_word data);
 
-// Prints non-zero memory contents to the specified output file.
-extern void print_memory(FILE* output_file);
+// Attaches a memory mapped device to a range of addresses outside RAM.
+extern void memory_register_device(uint32_t base, uint32_t size, DeviceRead read, DeviceWrite write, void *state);
+// Detaches every memory mapped device.
+extern void memory_clear_devices(void);
+
+// Sets the callback told about every data access (instruction fetches excluded), or NULL for none.
+extern void memory_set_observer(MemoryObserver observer);
+
+// Turns on or off tracking which pages are written, so that clearing and copying memory skip the rest (off by default).
+extern void memory_track_writes(bool enabled);
+
+// Copies the whole of RAM into a buffer of NUM_OF_MEMORY_ADDRESS bytes, with a map of its pages that may be non-zero.
+// The buffer and map must start out zeroed or hold an earlier snapshot; only written pages are copied.
+extern void memory_snapshot(uint8_t *buffer, uint8_t *written_pages);
+// Replaces the whole of RAM with a buffer and page map filled in by memory_snapshot.
+extern void memory_restore(const uint8_t *buffer, const uint8_t *written_pages);
+
+// Formats non-zero memory contents into an output buffer, in the format of the ".out" file.
+extern void format_memory(OutputBuffer *ob);
 
 #endif /* MEMORY_H */
@@ -0,0 +1,124 @@
+/**
+ * @file plugin.c
+ * @brief Definitions for loading instrumentation plugins and raising their events.
+ * @details The instrumented loop steps one instruction at a time with step_instruction, so that
+ *          run_cpu itself has no event points and its fused handlers are unaffected. Memory
+ *          accesses are seen through the memory observer, which is only set while a plugin wants
+ *          them. See plugin.h for the events and how a plugin registers for them.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <dlfcn.h>
+
+#include "plugin.h"
+#include "cpu.h"
+#include "memory.h"
+#include "register.h"
+
+static PluginHooks plugins[MAX_PLUGINS];
+static int num_plugins;
+
+/**
+ * @brief Memory observer passing every data access on to the plugins that want it.
+ */
+static void notify_memory_access(uint32_t address, uint32_t length, bool is_write) {
+    for (int i = 0; i < num_plugins; i++) {
+        if (plugins[i].memory_access != NULL) {
+            plugins[i].memory_access(plugins[i].data, address, length, is_write);
+        }
+    }
+}
+
+/**
+ * @brief Registers the callbacks of a plugin.
+ *
+ * @param hooks The callbacks and the data pointer to pass them, copied by the function.
+ *
+ * @note The function exits the program if MAX_PLUGINS plugins are already registered.
+ */
+void plugin_register(const PluginHooks *hooks) {
+    if (num_plugins == MAX_PLUGINS) {
+        fprintf(stderr, "Too many plugins, at most %d can be loaded\n", MAX_PLUGINS);
+        exit(EXIT_FAILURE);
+    }
+    plugins[num_plugins++] = *hooks;
+    if (hooks->memory_access != NULL) {
+        memory_set_observer(notify_memory_access);
+    }
+}
+
+/**
+ * @brief Loads a plugin and lets it register its callbacks.
+ *
+ * @param plugin_path Path of the shared object, which must define PLUGIN_INIT_SYMBOL.
+ *
+ * @note The function exits the program if the shared object cannot be loaded or has no init function.
+ */
+void plugin_load(const char *plugin_path) {
+    void *handle = dlopen(plugin_path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        fprintf(stderr, "Failed to load plugin %s: %s\n", plugin_path, dlerror());
+        exit(EXIT_FAILURE);
+    }
+    void (*init)(void);
+    *(void **) &init = dlsym(handle, PLUGIN_INIT_SYMBOL);
+    if (init == NULL) {
+        fprintf(stderr, "Plugin %s does not define %s\n", plugin_path, PLUGIN_INIT_SYMBOL);
+        exit(EXIT_FAILURE);
+    }
+    init();
+}
+
+/* To choose between the instrumented loop and run_cpu (e.g. in emulate) */
+bool plugin_loaded(void) {
+    return num_plugins > 0;
+}
+
+/**
+ * @brief Runs the CPU until it halts or a limit stops it, raising the plugins' events.
+ *
+ * The instruction limit and stop requests are checked after every branch, as in run_cpu.
+ *
+ * @param max_instructions Number of instructions to stop after, or UINT64_MAX for no limit.
+ * @return true if the CPU halted, false if max_instructions or stop_cpu stopped it first.
+ */
+bool plugin_run(uint64_t max_instructions) {
+    while (true) {
+        uint64_t pc = get_spec_register(PROGRAM_COUNTER);
+        Instruction inst = {.data = get_instruction(pc)};
+        if (!step_instruction()) {
+            // Leave the PC on the halt instruction, where run_cpu leaves it
+            set_spec_register(PROGRAM_COUNTER, pc);
+            for (int i = 0; i < num_plugins; i++) {
+                if (plugins[i].halt != NULL) {
+                    plugins[i].halt(plugins[i].data, pc);
+                }
+            }
+            return true;
+        }
+
+        for (int i = 0; i < num_plugins; i++) {
+            if (plugins[i].instruction_retired != NULL) {
+                plugins[i].instruction_retired(plugins[i].data, pc, inst.data);
+            }
+        }
+        if (inst.gen_branch.op0 != ITP_BRANCH) {
+            continue;
+        }
+
+        // Branches leave the flags alone, so they still say whether a conditional branch was taken,
+        // even one whose target is the next instruction
+        uint64_t target = get_spec_register(PROGRAM_COUNTER);
+        if (inst.branch_conditional.id != ITP_BRANCH_COND || condition_holds(inst.branch_conditional.cond)) {
+            for (int i = 0; i < num_plugins; i++) {
+                if (plugins[i].branch_taken != NULL) {
+                    plugins[i].branch_taken(plugins[i].data, pc, target);
+                }
+            }
+        }
+        if (get_instruction_count() >= max_instructions || cpu_stop_requested()) {
+            return false;
+        }
+    }
+}
@@ -0,0 +1,56 @@
+/**
+ * @file plugin.h
+ * @brief Interface between the emulator and instrumentation plugins.
+ * @details A plugin is a shared object loaded with `emulate --plugin FILE`. It defines
+ *
+ *              void armv8_plugin_init(void);
+ *
+ *          which registers callbacks for the events it wants with plugin_register. Any callback
+ *          may be NULL. The events are:
+ *          - instruction retired: after every instruction but the halt, with its address and encoding
+ *          - memory access: before every data load or store, with its address, size and direction
+ *          - branch taken: after every branch that changes the flow of control, with where it went
+ *          - halt: once the halt instruction is reached, with its address
+ *
+ *          While any plugin is loaded, the emulator runs an instrumented loop that raises these
+ *          events. With none loaded it runs the usual loop, which has no event points at all, so
+ *          plugins cost nothing unless they are used.
+ *
+ *          The emulator is built with -rdynamic, so a plugin can also call the emulator's own
+ *          functions, such as get_reg_value_64, from its callbacks.
+ */
+
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Largest number of plugins that can be registered
+#define MAX_PLUGINS 8
+
+// Name of the function every plugin defines to register its callbacks
+#define PLUGIN_INIT_SYMBOL "armv8_plugin_init"
+
+// Callbacks of one plugin, each given the plugin's own data pointer first
+typedef struct {
+    void (*instruction_retired)(void *data, uint64_t pc, uint32_t instruction);
+    void (*memory_access)(void *data, uint32_t address, uint32_t size, bool is_write);
+    void (*branch_taken)(void *data, uint64_t from, uint64_t to);
+    void (*halt)(void *data, uint64_t pc);
+    void *data;
+} PluginHooks;
+
+// Registers a plugin's callbacks, which are copied
+extern void plugin_register(const PluginHooks *hooks);
+
+// Loads a plugin from a shared object and runs its init function
+extern void plugin_load(const char *plugin_path);
+
+// Whether any plugin has been registered
+extern bool plugin_loaded(void);
+
+// Runs the CPU like run_cpu, raising the plugins' events, and returns true if it halted
+extern bool plugin_run(uint64_t max_instructions);
+
+#endif /* PLUGIN_H */
@@ -0,0 +1,239 @@
+/**
+ * @file profile.c
+ * @brief Definitions for the sampling profiler of the emulator.
+ *
+ * Sampling every N instructions reuses the instruction limit of run_cpu: the CPU runs until the
+ * next sample point, at the end of a basic block, is sampled, and carries on. Sampling on a timer
+ * takes the sample in the SIGPROF handler itself, so the CPU never stops. Either way run_cpu's
+ * loop is untouched, and the only cost is that of taking the samples.
+ *
+ * Samples are counted in a fixed-size hash table keyed by PC and caller, which the signal
+ * handler can update without allocating. A sample that finds the table full is dropped and
+ * counted as such.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "profile.h"
+#include "cpu.h"
+#include "memory.h"
+#include "register.h"
+
+// Number of distinct (PC, caller) pairs the profiler can count
+#define PROFILE_TABLE_SIZE 65536
+// Caller of a sample taken outside any call, as far as x30 tells
+#define NO_CALLER UINT64_MAX
+// Register holding the return address of a call
+#define LINK_REGISTER 30
+// Number of addresses listed in the flat profile
+#define FLAT_PROFILE_LENGTH 20
+
+// Samples counted at one PC with one caller
+typedef struct {
+    uint64_t pc;
+    uint64_t caller;
+    uint64_t samples;     // 0 for an unused entry
+} ProfileEntry;
+
+static ProfileEntry table[PROFILE_TABLE_SIZE];
+static uint64_t total_samples;
+static uint64_t dropped_samples;
+
+// How samples were taken, for the report
+static uint64_t sample_period;
+static bool timer_sampling;
+
+/**
+ * @brief Guesses the call site a sample was taken under from the link register.
+ *
+ * @return Address of the unconditional branch just before the address in x30, or NO_CALLER if x30
+ *         does not hold such a return address.
+ */
+static uint64_t guess_caller(void) {
+    uint64_t return_address = get_reg_value_64(LINK_REGISTER);
+    if (return_address < INSTR_SIZE || return_address >= NUM_OF_MEMORY_ADDRESS || return_address % INSTR_SIZE != 0) {
+        return NO_CALLER;
+    }
+    Instruction call = {.data = get_instruction(return_address - INSTR_SIZE)};
+    if (call.gen_branch.op0 != ITP_BRANCH || call.branch_conditional.id == ITP_BRANCH_COND) {
+        return NO_CALLER;
+    }
+    return return_address - INSTR_SIZE;
+}
+
+/**
+ * @brief Counts a sample of the current PC. This is safe to call from a signal handler.
+ */
+static void take_sample(void) {
+    uint64_t pc = get_spec_register(PROGRAM_COUNTER);
+    uint64_t caller = guess_caller();
+    uint64_t hash = (pc * 0x9e3779b97f4a7c15 ^ caller) >> 16;
+
+    for (uint64_t probe = 0; probe < PROFILE_TABLE_SIZE; probe++) {
+        ProfileEntry *entry = &table[(hash + probe) % PROFILE_TABLE_SIZE];
+        if (entry->samples == 0) {
+            entry->pc = pc;
+            entry->caller = caller;
+        }
+        if (entry->pc == pc && entry->caller == caller) {
+            entry->samples++;
+            total_samples++;
+            return;
+        }
+    }
+    dropped_samples++;
+}
+
+/**
+ * @brief Runs the CPU until it halts or a limit stops it, sampling the PC every period instructions.
+ *
+ * Each sample is taken at the end of the basic block that reaches the sample point, which is
+ * where run_cpu checks its instruction limit.
+ *
+ * @param period Number of instructions between samples, at least 1.
+ * @param max_instructions Number of instructions to stop after, or UINT64_MAX for no limit.
+ * @return true if the CPU halted, false if max_instructions or stop_cpu stopped it first.
+ */
+bool profile_run(uint64_t period, uint64_t max_instructions) {
+    sample_period = period;
+    bool halted = false;
+    while (!halted) {
+        uint64_t count = get_instruction_count();
+        uint64_t next_sample = period > UINT64_MAX - count ? UINT64_MAX : count + period;
+        set_instruction_limit(next_sample < max_instructions ? next_sample : max_instructions);
+        halted = run_cpu();
+        if (!halted && (get_instruction_count() >= max_instructions || cpu_stop_requested())) {
+            break;
+        }
+        take_sample();
+    }
+    set_instruction_limit(max_instructions);
+    return halted;
+}
+
+// Handler for the profiling timer
+static void handle_tick(int signal_number) {
+    take_sample();
+}
+
+/**
+ * @brief Starts sampling the PC on a timer measuring the CPU time of the process.
+ *
+ * The kernel may round the period up to its own timer tick, often 1 to 10 milliseconds.
+ *
+ * @param period_us Microseconds of CPU time between samples, at least 1.
+ */
+void profile_start_timer(uint64_t period_us) {
+    timer_sampling = true;
+    sample_period = period_us;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_tick;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, NULL);
+
+    struct timeval interval = {.tv_sec = period_us / 1000000, .tv_usec = period_us % 1000000};
+    struct itimerval timer = {.it_interval = interval, .it_value = interval};
+    setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+/**
+ * @brief Stops the timer started by profile_start_timer, so that no sample lands in the report.
+ */
+void profile_stop_timer(void) {
+    struct itimerval timer = {0};
+    setitimer(ITIMER_PROF, &timer, NULL);
+    signal(SIGPROF, SIG_IGN);
+}
+
+// Orders entries by PC, for adding up the samples of each PC
+static int compare_pc(const void *a, const void *b) {
+    const ProfileEntry *x = a, *y = b;
+    return x->pc < y->pc ? -1 : x->pc > y->pc;
+}
+
+// Orders entries by decreasing number of samples, then by PC
+static int compare_samples(const void *a, const void *b) {
+    const ProfileEntry *x = a, *y = b;
+    if (x->samples != y->samples) {
+        return x->samples > y->samples ? -1 : 1;
+    }
+    return compare_pc(a, b);
+}
+
+/**
+ * @brief Writes the flat profile, the hottest addresses with their share of the samples.
+ */
+static void write_flat_profile(FILE *output_file) {
+    // Gather the used entries and merge those at the same PC under different callers
+    ProfileEntry *entries = malloc(PROFILE_TABLE_SIZE * sizeof(ProfileEntry));
+    if (entries == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t num_entries = 0;
+    for (size_t i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        if (table[i].samples > 0) {
+            entries[num_entries++] = table[i];
+        }
+    }
+    qsort(entries, num_entries, sizeof(ProfileEntry), compare_pc);
+    size_t num_pcs = 0;
+    for (size_t i = 0; i < num_entries; i++) {
+        if (num_pcs > 0 && entries[num_pcs - 1].pc == entries[i].pc) {
+            entries[num_pcs - 1].samples += entries[i].samples;
+        } else {
+            entries[num_pcs++] = entries[i];
+        }
+    }
+    qsort(entries, num_pcs, sizeof(ProfileEntry), compare_samples);
+
+    fprintf(output_file, "Profile: %lu samples, one every %lu %s\n", total_samples, sample_period,
+            timer_sampling ? "microseconds of CPU time" : "instructions");
+    if (dropped_samples > 0) {
+        fprintf(output_file, "Profile: %lu samples dropped, too many distinct addresses\n", dropped_samples);
+    }
+    uint64_t loops, iterations;
+    get_fast_forward_stats(&loops, &iterations);
+    if (loops > 0) {
+        fprintf(output_file, "Profile: %lu loops fast-forwarded, %lu iterations skipped\n", loops, iterations);
+    }
+    fprintf(output_file, "  samples       %%  address\n");
+    for (size_t i = 0; i < num_pcs && i < FLAT_PROFILE_LENGTH; i++) {
+        fprintf(output_file, "%9lu  %5.1f%%  0x%08lx\n", entries[i].samples,
+                100.0 * entries[i].samples / total_samples, entries[i].pc);
+    }
+    free(entries);
+}
+
+/**
+ * @brief Writes the samples as folded stacks, one "caller;pc count" line per stack, caller first.
+ */
+static void write_folded_stacks(FILE *output_file) {
+    for (size_t i = 0; i < PROFILE_TABLE_SIZE; i++) {
+        const ProfileEntry *entry = &table[i];
+        if (entry->samples == 0) {
+            continue;
+        }
+        if (entry->caller != NO_CALLER) {
+            fprintf(output_file, "0x%08lx;", entry->caller);
+        }
+        fprintf(output_file, "0x%08lx %lu\n", entry->pc, entry->samples);
+    }
+}
+
+/**
+ * @brief Writes out the samples taken.
+ *
+ * @param flat_file Stream for the flat profile, such as stderr.
+ * @param folded_file Stream for the folded stacks, or NULL to leave them out.
+ */
+void profile_report(FILE *flat_file, FILE *folded_file) {
+    write_flat_profile(flat_file);
+    if (folded_file != NULL) {
+        write_folded_stacks(folded_file);
+    }
+}
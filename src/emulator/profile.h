@@ -0,0 +1,34 @@
+/**
+ * @file profile.h
+ * @brief Header file for the sampling profiler of the emulator.
+ *
+ * Rather than counting every instruction, the profiler records the guest PC now and then: either
+ * every N retired instructions, or on every tick of a host CPU-time timer. The samples are
+ * aggregated into a flat profile of the hottest addresses, and into folded stacks that flame
+ * graph tools read, so that profiling can be left on for every run at very little cost.
+ *
+ * The instruction set has no branch with link, so programs make calls by setting x30 to the
+ * return address and branching. A sample's caller is therefore guessed from x30: if it holds an
+ * address in RAM just after an unconditional branch, that branch is taken to be the call site.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Runs the CPU like run_cpu, sampling the PC every period instructions, and returns true if it halted.
+extern bool profile_run(uint64_t period, uint64_t max_instructions);
+
+// Starts sampling the PC on a host timer firing every period_us microseconds of CPU time.
+extern void profile_start_timer(uint64_t period_us);
+
+// Stops the host timer started by profile_start_timer.
+extern void profile_stop_timer(void);
+
+// Writes the flat profile to a stream, and the folded stacks to another one unless it is NULL.
+extern void profile_report(FILE *flat_file, FILE *folded_file);
+
+#endif /* PROFILE_H */
@@ -4,30 +4,88 @@
  * @details This header file contains the function declarations for register struct and
  *          its getters and setters. These are required to keep track of which register
  *          mode was last written to.
+ *
+ *          The general registers live in a flat register file of 32 slots, X0 to X30 followed
+ *          by the zero register. Register numbers come from 5-bit instruction fields, so every
+ *          number names a slot and the accessors need no range checks. A write to the zero
+ *          register lands in its slot and is wiped straight after, so the zero register needs
+ *          no test either. The accessors used by every instruction are defined inline here.
+ *
+ *          Every host thread has its own register file and special registers, which is what
+ *          gives each core run by smp_run its own registers and PC.
  */
 #ifndef REGISTER_H
 #define REGISTER_H
 
 #include <stdint.h>
+#include <stdio.h>
+
+#include "../output_buffer.h"
 
 #define NUM_REGISTERS 31
 
+// Number of slots in the register file, the general registers followed by the zero register
+#define REGISTER_FILE_SIZE (NUM_REGISTERS + 1)
+
+// Mask keeping a register number within the register file
+#define REGISTER_NUMBER_MASK (REGISTER_FILE_SIZE - 1)
+
+// Size of an instruction in bytes, which increment_pc moves the program counter on by
+#define REGISTER_INSTR_SIZE 4
+
+// Storage class of the state each core has its own copy of. The initial-exec model lets every
+// access in libarmv8.so reach the thread's copy at a fixed offset from the thread pointer, rather
+// than through a call to __tls_get_addr, at the cost of the library taking static TLS space.
+#define CORE_LOCAL _Thread_local __attribute__((tls_model("initial-exec")))
+
 typedef enum {ZERO_REGISTER, PROGRAM_COUNTER, STACK_POINTER} SpecRegisterType;
 
+#define NUM_SPEC_REGISTERS 3
+
+// X0 to X30 then the zero register, only to be used through the accessors below
+extern CORE_LOCAL uint64_t register_file[REGISTER_FILE_SIZE];
+
+// Special registers indexed by SpecRegisterType, only to be used through the accessors below
+extern CORE_LOCAL uint64_t spec_register_file[NUM_SPEC_REGISTERS];
+
 // ---------------------------GETTERS AND SETTERS-------------------------
 
 extern void init_register(void);
 
-extern void set_reg_value(uint32_t reg_num, uint64_t value);
-extern uint32_t get_reg_value_32(uint32_t reg_num);
-extern uint64_t get_reg_value_64(uint32_t reg_num);
+// Sets general register reg_num, where a write to the zero register (31) is discarded
+static inline void set_reg_value(uint32_t reg_num, uint64_t value) {
+    register_file[reg_num & REGISTER_NUMBER_MASK] = value;
+    register_file[NUM_REGISTERS] = 0;
+}
+
+// Gets the low 32 bits of general register reg_num, or 0 for the zero register (31)
+static inline uint32_t get_reg_value_32(uint32_t reg_num) {
+    return (uint32_t) register_file[reg_num & REGISTER_NUMBER_MASK];
+}
+
+// Gets general register reg_num, or 0 for the zero register (31)
+static inline uint64_t get_reg_value_64(uint32_t reg_num) {
+    return register_file[reg_num & REGISTER_NUMBER_MASK];
+}
+
+// Gets a special register
+static inline uint64_t get_spec_register(SpecRegisterType reg_type) {
+    return spec_register_file[reg_type];
+}
 
-extern uint64_t get_spec_register(SpecRegisterType reg_type);
 extern void set_spec_register(SpecRegisterType reg_type, uint64_t value);
 
-extern void increase_pc(int64_t offset);
-extern void increment_pc(void);
+// Moves the program counter by an offset in bytes, which may be negative
+static inline void increase_pc(int64_t offset) {
+    spec_register_file[PROGRAM_COUNTER] += offset;
+}
+
+// Moves the program counter on to the next instruction
+static inline void increment_pc(void) {
+    spec_register_file[PROGRAM_COUNTER] += REGISTER_INSTR_SIZE;
+}
 
-extern void print_registers(FILE* output_file);
+// Formats all registers and the PC into an output buffer, in the format of the ".out" file.
+extern void format_registers(OutputBuffer *ob);
 
 #endif /* REGISTER_H */
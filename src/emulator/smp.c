@@ -0,0 +1,128 @@
+/**
+ * @file smp.c
+ * @brief Definitions for running the emulated machine with several cores, one host thread each.
+ * @details See smp.h for what each core starts with, when it halts and how the cores see memory.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "smp.h"
+#include "cpu.h"
+#include "memory.h"
+#include "register.h"
+#include "../utils.h"
+
+// What a core's thread is given to run
+typedef struct {
+    int core_number;
+    CoreState *state;
+} CoreJob;
+
+/**
+ * @brief Runs one core on the calling thread, whose registers and flags start out as a fresh CPU's.
+ *
+ * @param argument The core's CoreJob.
+ * @return NULL.
+ */
+static void *run_core(void *argument) {
+    CoreJob *job = argument;
+    CoreState *state = job->state;
+
+    init_register();
+    set_reg_value(0, job->core_number);
+    state->halted = run_cpu();
+
+    for (int i = 0; i < NUM_REGISTERS; i++) {
+        state->registers[i] = get_reg_value_64(i);
+    }
+    state->program_counter = get_spec_register(PROGRAM_COUNTER);
+    state->pstate = get_pstate();
+    state->instruction_count = get_instruction_count();
+    return NULL;
+}
+
+/**
+ * @brief Runs the loaded program on several cores, each on its own host thread, until they all stop.
+ *
+ * @param num_cores Number of cores, from 1 to MAX_CORES.
+ * @param cores Array of num_cores states, filled in with the state of each core once it has stopped.
+ * @return true if every core halted, false if any was stopped by the instruction limit or stop_cpu.
+ */
+bool smp_run(int num_cores, CoreState *cores) {
+    assert_msg(num_cores >= 1 && num_cores <= MAX_CORES, "Invalid number of cores\n");
+    CoreJob jobs[MAX_CORES];
+    pthread_t threads[MAX_CORES];
+
+    for (int i = 0; i < num_cores; i++) {
+        jobs[i].core_number = i;
+        jobs[i].state = &cores[i];
+        assert_msg(pthread_create(&threads[i], NULL, run_core, &jobs[i]) == 0, "Failed to create thread\n");
+    }
+
+    bool all_halted = true;
+    for (int i = 0; i < num_cores; i++) {
+        pthread_join(threads[i], NULL);
+        all_halted = all_halted && cores[i].halted;
+    }
+    return all_halted;
+}
+
+/**
+ * @brief Adds up the instructions executed by every core.
+ *
+ * @param num_cores Number of cores.
+ * @param cores States of the cores, as filled in by smp_run.
+ * @return The total number of instructions.
+ */
+uint64_t smp_instruction_count(int num_cores, const CoreState *cores) {
+    uint64_t total = 0;
+    for (int i = 0; i < num_cores; i++) {
+        total += cores[i].instruction_count;
+    }
+    return total;
+}
+
+/**
+ * @brief Prints the state of every core followed by memory.
+ *
+ * Each core is introduced by a "Core N:" line and printed as print_cpu prints the single core,
+ * registers then PSTATE. The non-zero memory, which the cores share, follows once at the end.
+ *
+ * @param output_file_path The path to the output file, or NULL for stdout.
+ * @param num_cores Number of cores.
+ * @param cores States of the cores, as filled in by smp_run.
+ */
+void smp_print(const char *output_file_path, int num_cores, const CoreState *cores) {
+    FILE *output_file = output_file_path == NULL ? stdout : fopen(output_file_path, "w");
+    if (output_file == NULL) {
+        fprintf(stderr, "Failed to open file %s\n", output_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    OutputBuffer *ob = output_buffer_init();
+    for (int core = 0; core < num_cores; core++) {
+        const CoreState *state = &cores[core];
+        output_buffer_append(ob, "Core ");
+        output_buffer_append_decimal(ob, core, 1);
+        output_buffer_append(ob, ":\nRegisters:\n");
+        for (int i = 0; i < NUM_REGISTERS; i++) {
+            output_buffer_append(ob, "X");
+            output_buffer_append_decimal(ob, i, 2);
+            output_buffer_append(ob, "    = ");
+            output_buffer_append_hex(ob, state->registers[i], 16);
+            output_buffer_append(ob, "\n");
+        }
+        output_buffer_append(ob, "PC     = ");
+        output_buffer_append_hex(ob, state->program_counter, 16);
+        output_buffer_append(ob, "\n");
+        format_pstate(ob, state->pstate);
+    }
+    format_memory(ob);
+    output_buffer_write(ob, output_file);
+    output_buffer_free(ob);
+
+    if (output_file_path != NULL) {
+        fclose(output_file);
+    }
+}
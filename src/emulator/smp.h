@@ -0,0 +1,56 @@
+/**
+ * @file smp.h
+ * @brief Header file for running the emulated machine with several cores.
+ * @details Each core runs run_cpu on its own host thread. The registers, PC, flags and instruction
+ *          count of the CPU are thread-local, so every core has its own, while memory is shared.
+ *
+ *          Start: every core runs the loaded program from address 0 with all registers zero,
+ *          except that x0 holds the core's number (0 for the first core), so that firmware can
+ *          tell the cores apart. Core 0 therefore starts exactly as the single core does.
+ *
+ *          Halt: a core stops when it executes the halt instruction, and the others carry on.
+ *          The machine stops once every core has stopped. The instruction limit applies to each
+ *          core separately, and stop_cpu (the emulator's --timeout) stops every core.
+ *
+ *          Memory ordering: an aligned load or store of a word or double word is single-copy
+ *          atomic, so another core sees either all of a store or none of it. Unaligned accesses
+ *          are made byte by byte, each byte atomic, so they may be seen in parts. A core sees its
+ *          own accesses in program order, but there is no guarantee about the order in which one
+ *          core's stores to different addresses become visible to another core, as on ARMv8
+ *          without barrier instructions (which the emulated instruction set lacks). Once every
+ *          core has stopped, all of their stores are visible, so the final dump is complete.
+ *
+ *          Memory mapped devices and the memory observer are not thread safe, so the GPIO
+ *          controller, the timing model and co-simulation cannot be used with several cores.
+ */
+
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "cpu.h"
+
+// Largest number of cores smp_run can run
+#define MAX_CORES 64
+
+// State of one core once it has stopped
+typedef struct {
+    uint64_t registers[NUM_REGISTERS];
+    uint64_t program_counter;
+    processor_state pstate;
+    uint64_t instruction_count;
+    bool halted;        // Whether the core executed the halt instruction, rather than being stopped
+} CoreState;
+
+// Runs the loaded program on several cores, returning true if every core halted
+extern bool smp_run(int num_cores, CoreState *cores);
+
+// Total number of instructions executed by the cores
+extern uint64_t smp_instruction_count(int num_cores, const CoreState *cores);
+
+// Print the state of every core and memory to a file or stdout, in the format of print_cpu per core
+extern void smp_print(const char *output_file_path, int num_cores, const CoreState *cores);
+
+#endif /* SMP_H */
@@ -0,0 +1,224 @@
+/**
+ * @file timing.c
+ * @brief Cycle-approximate timing model of the emulator.
+ *
+ * Every instruction is charged the cost of its class, and every data access made through
+ * get_word, set_word, get_double_word or set_double_word is additionally charged a hit or miss
+ * cost from a direct-mapped, write-allocate cache model. Accesses to devices outside RAM are
+ * uncached and always charged as misses. Instruction fetches are assumed to always hit and cost
+ * nothing beyond the instruction's own cost.
+ *
+ * The costs and the cache geometry can be set in a cost file with one "name value" pair per line,
+ * where blank lines and lines starting with '#' are ignored. The names, and their defaults, are:
+ *
+ *     alu 1
+ *     multiply 3
+ *     load_store 1
+ *     branch_taken 2
+ *     branch_not_taken 1
+ *     cache_hit 1
+ *     cache_miss 20
+ *     cache_lines 256
+ *     cache_line_size 64
+ *
+ * cache_lines and cache_line_size must be powers of two, and cache_line_size at most the size of memory.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "timing.h"
+#include "memory.h"
+
+#define COST_LINE_SIZE 128
+#define NUM_COSTS 9
+
+// Index of each setting in the cost table
+typedef enum {
+    COST_ALU,
+    COST_MULTIPLY,
+    COST_LOAD_STORE,
+    COST_BRANCH_TAKEN,
+    COST_BRANCH_NOT_TAKEN,
+    COST_CACHE_HIT,
+    COST_CACHE_MISS,
+    COST_CACHE_LINES,
+    COST_CACHE_LINE_SIZE
+} CostIndex;
+
+// Names of the settings in a cost file, in CostIndex order
+static const char *const cost_names[NUM_COSTS] = {
+    "alu", "multiply", "load_store", "branch_taken", "branch_not_taken",
+    "cache_hit", "cache_miss", "cache_lines", "cache_line_size"
+};
+
+static const uint64_t default_costs[NUM_COSTS] = {1, 3, 1, 2, 1, 1, 20, 256, 64};
+
+static uint64_t costs[NUM_COSTS];
+
+// Cycles charged and instructions executed since the model was started
+static uint64_t cycles;
+static uint64_t instructions;
+
+// Cache model: the tag held by each line, or INVALID_TAG
+#define INVALID_TAG UINT32_MAX
+static uint32_t *cache_tags;
+static uint32_t line_shift;
+static uint64_t cache_hits;
+static uint64_t cache_misses;
+
+/**
+ * @brief Checks whether a number is a non-zero power of two.
+ */
+static bool is_power_of_two(uint64_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+/**
+ * @brief Reads the settings in a cost file over the defaults.
+ *
+ * @param cost_file_path Path of the cost file.
+ *
+ * @note The function exits the program with a failure status if the file cannot be read or
+ *       contains an unknown setting or invalid value.
+ */
+static void read_costs(const char *cost_file_path) {
+    FILE *cost_file = fopen(cost_file_path, "r");
+    if (cost_file == NULL) {
+        fprintf(stderr, "Failed to open cost file %s\n", cost_file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    char line[COST_LINE_SIZE];
+    int line_number = 0;
+    while (fgets(line, COST_LINE_SIZE, cost_file) != NULL) {
+        line_number++;
+
+        char name[COST_LINE_SIZE];
+        unsigned long long value;
+        char first;
+        if (sscanf(line, " %c", &first) != 1 || first == '#') {
+            continue;
+        }
+        if (sscanf(line, "%s %llu", name, &value) != 2) {
+            fprintf(stderr, "%s:%d: expected a name and a value\n", cost_file_path, line_number);
+            exit(EXIT_FAILURE);
+        }
+
+        int index = 0;
+        while (index < NUM_COSTS && strcmp(name, cost_names[index]) != 0) {
+            index++;
+        }
+        if (index == NUM_COSTS) {
+            fprintf(stderr, "%s:%d: unknown cost %s\n", cost_file_path, line_number, name);
+            exit(EXIT_FAILURE);
+        }
+        costs[index] = value;
+    }
+
+    fclose(cost_file);
+}
+
+/**
+ * @brief Looks up one cache line, charging a hit or a miss and filling the line on a miss.
+ *
+ * @param line_address Address divided by the line size.
+ */
+static void access_line(uint32_t line_address) {
+    uint32_t index = line_address & (costs[COST_CACHE_LINES] - 1);
+    if (cache_tags[index] == line_address) {
+        cache_hits++;
+        cycles += costs[COST_CACHE_HIT];
+    } else {
+        cache_tags[index] = line_address;
+        cache_misses++;
+        cycles += costs[COST_CACHE_MISS];
+    }
+}
+
+/**
+ * @brief Memory observer charging the cost of a data access, which touches one or two cache lines.
+ */
+static void cache_access(uint32_t address, uint32_t length, bool is_write) {
+    if (address > NUM_OF_MEMORY_ADDRESS - length) {
+        cache_misses++;
+        cycles += costs[COST_CACHE_MISS];
+        return;
+    }
+
+    uint32_t first_line = address >> line_shift;
+    uint32_t last_line = (address + length - 1) >> line_shift;
+    access_line(first_line);
+    if (last_line != first_line) {
+        access_line(last_line);
+    }
+}
+
+/**
+ * @brief Starts the timing model with an empty cache and no cycles charged.
+ *
+ * @param cost_file_path Path of a cost file, or NULL to use the default costs.
+ *
+ * @note The function exits the program with a failure status if the cost file is invalid.
+ */
+void timing_init(const char *cost_file_path) {
+    memcpy(costs, default_costs, sizeof(costs));
+    if (cost_file_path != NULL) {
+        read_costs(cost_file_path);
+    }
+
+    if (!is_power_of_two(costs[COST_CACHE_LINES]) || !is_power_of_two(costs[COST_CACHE_LINE_SIZE])) {
+        fprintf(stderr, "cache_lines and cache_line_size must be powers of two\n");
+        exit(EXIT_FAILURE);
+    }
+    if (costs[COST_CACHE_LINE_SIZE] > NUM_OF_MEMORY_ADDRESS) {
+        fprintf(stderr, "cache_line_size must be at most the memory size of %d bytes\n", NUM_OF_MEMORY_ADDRESS);
+        exit(EXIT_FAILURE);
+    }
+
+    free(cache_tags);
+    cache_tags = malloc(costs[COST_CACHE_LINES] * sizeof(uint32_t));
+    if (cache_tags == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (uint64_t i = 0; i < costs[COST_CACHE_LINES]; i++) {
+        cache_tags[i] = INVALID_TAG;
+    }
+
+    line_shift = 0;
+    while ((1ULL << line_shift) < costs[COST_CACHE_LINE_SIZE]) {
+        line_shift++;
+    }
+
+    cycles = 0;
+    instructions = 0;
+    cache_hits = 0;
+    cache_misses = 0;
+    memory_set_observer(cache_access);
+}
+
+/**
+ * @brief Charges the cycles for one executed instruction.
+ *
+ * @param instruction_class Class of the instruction.
+ */
+void timing_charge(InstructionClass instruction_class) {
+    // InstructionClass and the first entries of CostIndex are in the same order
+    cycles += costs[instruction_class];
+    instructions++;
+}
+
+/**
+ * @brief Writes the total cycles, cycles per instruction and cache statistics to a stream.
+ *
+ * @param output_file Stream to write to.
+ */
+void timing_report(FILE *output_file) {
+    fprintf(output_file, "Cycles: %lu\n", cycles);
+    fprintf(output_file, "CPI: %.3f\n", instructions == 0 ? 0.0 : (double) cycles / instructions);
+    fprintf(output_file, "Cache hits: %lu\n", cache_hits);
+    fprintf(output_file, "Cache misses: %lu\n", cache_misses);
+}
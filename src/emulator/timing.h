@@ -0,0 +1,33 @@
+/**
+ * @file timing.h
+ * @brief Header file for the cycle-approximate timing model of the emulator.
+ *
+ * The model charges a configurable number of cycles for each class of instruction executed and
+ * for each data access, depending on whether it hits or misses in a direct-mapped cache. It gives
+ * an estimate of how long a program would take on hardware, for comparing variants of a kernel.
+ */
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdio.h>
+
+// Classes of instruction that are charged different numbers of cycles
+typedef enum {
+    TIMING_ALU,                // Arithmetic, logic and wide moves
+    TIMING_MULTIPLY,           // Multiply-add and multiply-subtract
+    TIMING_LOAD_STORE,         // Loads and stores, before the cost of the access itself
+    TIMING_BRANCH_TAKEN,       // Branches that change the flow of control
+    TIMING_BRANCH_NOT_TAKEN    // Conditional branches that fall through
+} InstructionClass;
+
+// Starts the timing model, with costs read from a file or the defaults if cost_file_path is NULL.
+extern void timing_init(const char *cost_file_path);
+
+// Charges the cycles for one executed instruction of the given class.
+extern void timing_charge(InstructionClass instruction_class);
+
+// Writes the total cycles, CPI and cache statistics to a stream.
+extern void timing_report(FILE *output_file);
+
+#endif /* TIMING_H */
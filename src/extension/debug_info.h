@@ -10,7 +10,7 @@
 // Define the enum to reference each string - NUM_HELP_COMMANDS used later in print_help
 typedef enum {
     CMD_RUN, CMD_QUIT, CMD_CONTINUE, CMD_NEXT, CMD_REFRESH, CMD_BREAKPOINT, CMD_CLEAR,
-    CMD_PRINT, CMD_SET, CMD_INFO, CMD_HELP, NUM_HELP_COMMANDS,
+    CMD_PRINT, CMD_SET, CMD_INFO, CMD_FORK, CMD_HELP, NUM_HELP_COMMANDS,
     CMD_MEMORY, CMD_REGISTERS, CMD_PSTATE, CMD_BREAKPOINTS, CMD_NULL,
 } CommandRef;
 
@@ -27,6 +27,7 @@ const char* const cmd_names[] = {
     [CMD_SET] = "set",
     [CMD_HELP] = "help",
     [CMD_INFO] = "info",
+    [CMD_FORK] = "fork",
     [CMD_MEMORY] = "memory",
     [CMD_REGISTERS] = "registers",
     [CMD_PSTATE] = "pstate",
@@ -46,6 +47,7 @@ const char* const cmd_short_names[] = {
     [CMD_SET] = "s",
     [CMD_HELP] = "h",
     [CMD_INFO] = "i",
+    [CMD_FORK] = "f",
     [CMD_MEMORY] = "mem",
     [CMD_REGISTERS] = "reg",
     [CMD_PSTATE] = "pst",
@@ -64,6 +66,7 @@ const char* const cmd_help[] = {
     [CMD_PRINT] = "Print value of register or memory",
     [CMD_SET] = "Assign value to a general register or a memory location",
     [CMD_INFO] = "Show information about all registers, non-zero memory locations or the program state",
+    [CMD_FORK] = "Run a copy of the program from here to the end, writing its final state to a file",
     [CMD_HELP] = "Show information about a specified command, or all commands",
 };
 
@@ -79,6 +82,7 @@ const char* const cmd_syntax[] = {
     [CMD_PRINT] = "Type 'p' or \"print\"",
     [CMD_SET] = "Type 's' or \"set\"",
     [CMD_INFO] = "Type 'i' or \"info\"",
+    [CMD_FORK] = "Type 'f' or \"fork\"",
     [CMD_HELP] = "Type 'h' or \"help\"",
 };
 
@@ -89,5 +93,6 @@ const char* const cmd_examples[] = {
     [CMD_PRINT] = "Example: p x30/*0x4 - Prints the value held at register x30/memory address 0x4",
     [CMD_SET] = "Example: s x0/*0x4 = 5 - Sets the value held at register x0/memory address 0x4 equal to 5",
     [CMD_INFO] = "Example: i bs - Prints the location of all breakpoints",
+    [CMD_FORK] = "Example: f x0_is_5.out - Runs a copy from the current state, ignoring breakpoints, and writes its final state to x0_is_5.out (a copy still running after 100000000 instructions is stopped)",
     [CMD_HELP] = "Example: h run - Prints information about the command \"run\"",
 };
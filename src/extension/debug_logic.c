@@ -4,11 +4,14 @@
 #include <string.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include "debug_logic.h"
 #include "debug_info.h"
 #include "window.h"
 #include "../utils.h"
+#include "../source_buffer.h"
 #include "../ADTs/darray.h"
 #include "../ADTs/hashmap.h"
 #include "../emulator/memory.h"
@@ -17,12 +20,14 @@
 #include "../assembler/decode_helper.h"
 #include "../assembler/decode.h"
 
-#define INITIAL_BUFFER_SIZE 10
 #define NO_LINE_HIGHLIGHT 0  // zero value removes the line highlight (indicating which line is running)
+#define FORK_INSTRUCTION_LIMIT 100000000  // instructions a forked copy may run before it is stopped
+#define FORK_EXIT_LIMIT_REACHED 2         // exit status of a forked copy stopped by the instruction limit
 
 typedef enum{ARG_1, ARG_2, ARG_3, ARG_4, MAX_NUM_ARGUMENTS} ArgumentNumber;
 typedef enum{PROGRAM_HALT = 0, PROGRAM_EXIT = 0, PROGRAM_CONTINUE} ProgramState;
 
+static SourceBuffer *source;
 static DArray *assembly_lines;
 static DArray *breakpoints;
 static HashMap *address_to_line;
@@ -121,51 +126,19 @@ static int invalid_user_input(char *user_input, CommandRef cmd_ref){
 
 /**
  * @brief Loads assembly code from a file into memory for debugging.
+ *
+ * The lines stored in `assembly_lines` are views into `source`, so they stay valid until the
+ * source buffer is freed in debugger_free.
+ *
  * @param input_file_path Path to the input file.
  */
 static void debugger_load_assembly(const char *input_file_path) {
-    FILE *input_file = fopen(input_file_path, "r");
-    if (input_file == NULL) {
-        fprintf(stderr, "Failed to open file %s\n", input_file_path);
-        exit(EXIT_FAILURE);
-    }
-
-    assert(input_file != NULL);
-    
-    int buffer_size = INITIAL_BUFFER_SIZE;
-    char *buffer    = malloc(buffer_size * sizeof(char));
-    int length      = 0;
-    
-    char c;
-
-    while ((c = fgetc(input_file)) != EOF) {
-        if (c == '\n') {
-            buffer[length] = '\0';
-            darray_add(assembly_lines, buffer);
-
-            buffer_size = INITIAL_BUFFER_SIZE;
-            buffer      = malloc(buffer_size * sizeof(char));
-            length      = 0;
-            continue;
-        } 
-
-        buffer[length++] = c;
-
-        if (length == buffer_size) {
-            buffer_size *= 2;
-            buffer = realloc(buffer, buffer_size);
-            assert(buffer != NULL);
-        }
-    }
+    source = source_buffer_open(input_file_path);
 
-    if (length != 0) { //last line did not end with \n
-        buffer[length] = '\0';
-        darray_add(assembly_lines, buffer);
-    } else {
-        free(buffer);
+    char *line;
+    while (source_buffer_next_line(source, &line)) {
+        darray_add(assembly_lines, line);
     }
-
-    fclose(input_file);
 }
 
 /**
@@ -178,6 +151,48 @@ static void debugger_reset_memory(){
     cur_line_number = 1;
 }
 
+/**
+ * @brief Runs a copy of the program from the current state to its end, writing the final state to a file.
+ *
+ * The copy is a child process made by machine_fork, so it shares the memory of the debugger
+ * copy-on-write and leaves the debugger's own state untouched. It runs without breakpoints, and
+ * the debugger waits for it, so several variants can be tried in turn from one point by setting
+ * registers or memory before each fork. A copy that has not halted after FORK_INSTRUCTION_LIMIT
+ * instructions is stopped, writing its state so far, so that a variant which never halts cannot
+ * hang the debugger.
+ *
+ * @param output_file_path Path of the file the copy writes its final state to.
+ */
+static void debugger_fork(const char *output_file_path) {
+    pid_t child = machine_fork();
+    if (child == -1) {
+        window_print("ERROR: Failed to fork the program.");
+        return;
+    }
+    if (child == 0) {
+        set_instruction_limit(get_instruction_count() + FORK_INSTRUCTION_LIMIT);
+        bool halted = run_cpu();
+        print_cpu(output_file_path);
+        _exit(halted ? EXIT_SUCCESS : FORK_EXIT_LIMIT_REACHED);
+    }
+
+    int status;
+    if (waitpid(child, &status, 0) == -1) {
+        window_print("ERROR: Failed to wait for the forked copy.");
+        return;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+        window_print("Forked copy halted, final state written to %s", output_file_path);
+    } else if (WIFEXITED(status) && WEXITSTATUS(status) == FORK_EXIT_LIMIT_REACHED) {
+        window_print("Forked copy stopped without halting after %d instructions, state so far written to %s",
+                     FORK_INSTRUCTION_LIMIT, output_file_path);
+    } else if (WIFSIGNALED(status)) {
+        window_print("Forked copy was killed by signal %d before halting", WTERMSIG(status));
+    } else {
+        window_print("Forked copy failed before halting, exit status %d", WEXITSTATUS(status));
+    }
+}
+
 // -------------------------------- Debugging Printing Functions ----------------------------------
 
 /**
@@ -197,13 +212,26 @@ static void debugger_print_memory(){
  */
 static void debugger_print_registers(){
     window_print("Registers:\n");
-    for (int i = 0; i < NUM_REGISTERS - 1; i = i + 5) {
-        window_print("X%02d = %016lx   X%02d = %016lx   X%02d = %016lx   X%02d = %016lx   X%02d = %016lx\n", 
-        i, get_reg_value_64(i), i+1, get_reg_value_64(i+1), i+2, get_reg_value_64(i+2), i+3, get_reg_value_64(i+3),
-        i+4, get_reg_value_64(i+4));
+    OutputBuffer *ob = output_buffer_init();
+    for (int i = 0; i <= NUM_REGISTERS; i++) {
+        output_buffer_append(ob, "X");
+        output_buffer_append_decimal(ob, i, 2);
+        output_buffer_append(ob, " = ");
+        output_buffer_append_hex(ob, get_reg_value_64(i), 16);
+        // Five registers to a line, each line its own window entry, with the last one finished off by the PC
+        if (i % 5 == 4) {
+            output_buffer_append(ob, "\n");
+            window_print("%s", output_buffer_contents(ob));
+            output_buffer_clear(ob);
+        } else {
+            output_buffer_append(ob, "   ");
+        }
     }
-    window_print("X%02d = %016lx   X%02d = %016lx   PC  = %016lx", NUM_REGISTERS-1, get_reg_value_64(NUM_REGISTERS-1),
-     NUM_REGISTERS, get_reg_value_64(NUM_REGISTERS), get_spec_register(PROGRAM_COUNTER));
+    output_buffer_append(ob, "PC  = ");
+    output_buffer_append_hex(ob, get_spec_register(PROGRAM_COUNTER), 16);
+
+    window_print("%s", output_buffer_contents(ob));
+    output_buffer_free(ob);
 }
 
 /**
@@ -427,6 +455,15 @@ static bool parse_input(char *user_input){
             return invalid_user_input(user_input, CMD_INFO);
         }
 
+        if (input_matches(arguments[ARG_1], CMD_FORK)){
+            if (!program_running){
+                window_print("The program has not started yet.");
+                return PROGRAM_CONTINUE;
+            }
+            debugger_fork(arguments[ARG_2]);
+            return PROGRAM_CONTINUE;
+        }
+
         if (input_matches(arguments[ARG_1], CMD_HELP)){
             debugger_print_help_cmd(arguments[ARG_2]);
             return PROGRAM_CONTINUE;
@@ -478,7 +515,7 @@ static bool parse_input(char *user_input){
  * @param input_file_path Path to the input assembly file.
  */
 void debugger_init(const char *input_file_path) {
-    assembly_lines = darray_init(free);
+    assembly_lines = darray_init(NULL);
     address_to_line = hashmap_init(free);
     breakpoints = darray_init(free);
     decode_init();
@@ -507,6 +544,7 @@ void debugger_run(void) {
  */
 void debugger_free(void) {
     darray_free(assembly_lines);
+    source_buffer_free(source);
     hashmap_free(address_to_line);
     darray_free(breakpoints);
     window_free();
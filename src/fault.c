@@ -0,0 +1,76 @@
+/**
+ * @file fault.c
+ * @brief Definitions for raising and catching faults in the assembler and emulator cores.
+ * @details See fault.h. Handlers form a linked stack through the caller's own FaultHandler
+ *          structures, so installing one allocates nothing.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "fault.h"
+
+// Innermost handler of this thread, or NULL if faults should exit
+static _Thread_local FaultHandler *current;
+
+/**
+ * @brief Makes a handler the innermost one of this thread.
+ *
+ * @param handler Handler to install, which must stay in scope until it is removed.
+ * @return The same handler, for fault_catch to set its jump buffer.
+ */
+FaultHandler *fault_push(FaultHandler *handler) {
+    handler->previous = current;
+    handler->message[0] = '\0';
+    current = handler;
+    return handler;
+}
+
+/**
+ * @brief Removes the innermost handler of this thread.
+ *
+ * @param handler Handler to remove, which must be the innermost one.
+ */
+void fault_pop(FaultHandler *handler) {
+    current = handler->previous;
+}
+
+/**
+ * @brief Checks whether this thread has a handler installed.
+ *
+ * Only reads a thread local, so a signal handler can call it to decide how to report a fault.
+ *
+ * @return true if a fault would return to a handler, false if it would exit.
+ */
+bool fault_handled(void) {
+    return current != NULL;
+}
+
+/**
+ * @brief Reports a fault.
+ *
+ * The message is formatted into the innermost handler, which is removed before control returns
+ * to its fault_catch. With no handler installed the message is printed to stderr instead.
+ *
+ * @param format printf style format of the message, followed by its arguments.
+ *
+ * @note The function exits the program with a failure status if no handler is installed.
+ */
+void fault_raise(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+
+    if (current == NULL) {
+        vfprintf(stderr, format, args);
+        va_end(args);
+        exit(EXIT_FAILURE);
+    }
+
+    FaultHandler *handler = current;
+    vsnprintf(handler->message, FAULT_MESSAGE_SIZE, format, args);
+    va_end(args);
+
+    current = handler->previous;
+    longjmp(handler->env, 1);
+}
@@ -0,0 +1,55 @@
+/**
+ * @file fault.h
+ * @brief Declarations for raising and catching faults in the assembler and emulator cores.
+ * @details A fault is an error in the program being assembled or emulated, such as an unknown
+ *          opcode or an out of bounds memory access. The cores report one with fault_raise and
+ *          never test for a caller, so the success path costs nothing extra.
+ *
+ *          With no handler installed, a fault prints its message to stderr and exits, as the
+ *          command line tools always have. A caller that reuses the process (the server, libarmv8
+ *          and the fuzzing harnesses) installs a handler with fault_catch, and the fault returns
+ *          control there instead:
+ *
+ *              FaultHandler handler;
+ *              if (fault_catch(&handler) != 0) {
+ *                  // handler.message says what went wrong; the handler is already removed
+ *                  return false;
+ *              }
+ *              decode(line);
+ *              fault_pop(&handler);
+ *
+ *          Handlers nest, and each thread has its own stack of them. Locals changed between
+ *          fault_catch and the fault must be volatile to be read in the handling branch.
+ */
+#ifndef FAULT_H
+#define FAULT_H
+
+#include <setjmp.h>
+#include <stdbool.h>
+
+#define FAULT_MESSAGE_SIZE 256
+
+// A point that faults return to, with the message of the fault once one has been raised
+typedef struct FaultHandler {
+    jmp_buf env;
+    struct FaultHandler *previous;
+    char message[FAULT_MESSAGE_SIZE];
+} FaultHandler;
+
+// Installs a handler, evaluating to 0 at first and to non-zero when a fault returns to it.
+// Must only be compared against 0 as the whole condition of an if, like setjmp itself.
+#define fault_catch(handler) setjmp(fault_push(handler)->env)
+
+// Makes a handler the innermost one of this thread, for fault_catch
+extern FaultHandler *fault_push(FaultHandler *handler);
+
+// Removes the innermost handler of this thread once the code it guards has finished
+extern void fault_pop(FaultHandler *handler);
+
+// Whether this thread has a handler installed, so that a fault returns to it rather than exiting
+extern bool fault_handled(void);
+
+// Reports a fault to the innermost handler, or prints the message and exits if there is none
+extern _Noreturn void fault_raise(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+#endif /* FAULT_H */
@@ -0,0 +1,247 @@
+/**
+ * @file armv8.c
+ * @brief Definitions for libarmv8, gluing the assembler and emulator modules together in memory.
+ * @details Each function is a thin wrapper over the modules used by the command line tools, so the
+ *          library assembles and runs programs exactly as `assemble` and `emulate` do. The wrappers
+ *          that take a program catch the faults it raises (see fault.h), so a bad program is
+ *          reported through armv8_error rather than ending the process.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "armv8.h"
+#include "../utils.h"
+#include "../fault.h"
+#include "../source_buffer.h"
+#include "../ADTs/darray.h"
+#include "../assembler/decode.h"
+#include "../emulator/cpu.h"
+#include "../emulator/memory.h"
+#include "../emulator/register.h"
+
+static char error_message[FAULT_MESSAGE_SIZE];   // Message of the most recent fault
+
+/**
+ * @brief Keeps the message of a fault for armv8_error.
+ * @param handler Handler that caught the fault.
+ */
+static void keep_error(const FaultHandler *handler) {
+    strcpy(error_message, handler->message);
+}
+
+/**
+ * @brief Gets the message of the most recent fault caught by the library.
+ * @return The message, which is empty if no fault has been caught yet.
+ */
+const char *armv8_error(void) {
+    return error_message;
+}
+
+/**
+ * @brief Assembles source text held in memory.
+ *
+ * @param source Assembly source text, which does not need to be null-terminated.
+ * @param length Number of characters of source text.
+ * @param num_instructions Pointer to store the number of instructions assembled (updated by reference).
+ * @return Newly allocated buffer of the assembled instructions, to be freed by the caller, or NULL
+ *         if the source is invalid (see armv8_error).
+ */
+uint32_t *armv8_assemble(const char *source, size_t length, size_t *num_instructions) {
+    decode_init();
+    SourceBuffer *sb = source_buffer_from_string(source, length);
+
+    FaultHandler handler;
+    if (fault_catch(&handler) != 0) {
+        keep_error(&handler);
+        source_buffer_free(sb);
+        decode_free();
+        return NULL;
+    }
+
+    char *line;
+    while (source_buffer_next_line(sb, &line)) {
+        if (is_blank_line(line)) continue; //no code on the line
+        decode(line);
+    }
+    fault_pop(&handler);
+    source_buffer_free(sb);
+
+    DArray *instructions = decode_get_instructions();
+    *num_instructions = darray_length(instructions);
+
+    uint32_t *words = malloc((*num_instructions > 0 ? *num_instructions : 1) * sizeof(uint32_t));
+    assert_msg(words != NULL, "Memory allocation failed\n");
+    for (size_t i = 0; i < *num_instructions; i++) {
+        words[i] = *(uint32_t *) darray_get(instructions, i);
+    }
+
+    decode_free();
+    return words;
+}
+
+/**
+ * @brief Resets the emulator and loads a buffer of instructions into memory from address 0.
+ *
+ * @param instructions Buffer holding the instructions to load.
+ * @param num_instructions Number of instructions in the buffer.
+ * @return true on success, false if the instructions do not fit in memory (see armv8_error).
+ */
+bool armv8_load(const uint32_t *instructions, size_t num_instructions) {
+    FaultHandler handler;
+    if (fault_catch(&handler) != 0) {
+        keep_error(&handler);
+        return false;
+    }
+    init_cpu_buffer(instructions, num_instructions);
+    fault_pop(&handler);
+    return true;
+}
+
+/**
+ * @brief Runs the loaded program until it halts.
+ * @return true once the program halts, false if it faults or reaches the instruction limit first
+ *         (see armv8_error).
+ */
+bool armv8_run(void) {
+    FaultHandler handler;
+    if (fault_catch(&handler) != 0) {
+        keep_error(&handler);
+        return false;
+    }
+    bool halted = run_cpu();
+    fault_pop(&handler);
+    if (!halted) {
+        snprintf(error_message, FAULT_MESSAGE_SIZE, "Stopped by instruction limit after %lu instructions\n",
+                 get_instruction_count());
+    }
+    return halted;
+}
+
+/**
+ * @brief Sets the number of instructions after which armv8_run stops, so a program that never
+ *        halts cannot run forever.
+ *
+ * The limit is checked at the end of each basic block, so the program may run a few instructions past it.
+ *
+ * @param limit Number of instructions, or UINT64_MAX for no limit.
+ */
+void armv8_set_instruction_limit(uint64_t limit) {
+    set_instruction_limit(limit);
+}
+
+/**
+ * @brief Turns the fused execution of common instruction sequences during armv8_run on or off (see set_fusion).
+ * @param enabled Whether to execute such sequences as one step.
+ */
+void armv8_set_fusion(bool enabled) {
+    set_fusion(enabled);
+}
+
+/**
+ * @brief Turns the fast-forwarding of pure counting loops during armv8_run on or off (see set_fast_forward).
+ * @param enabled Whether to skip the iterations of such loops in closed form.
+ */
+void armv8_set_fast_forward(bool enabled) {
+    set_fast_forward(enabled);
+}
+
+/**
+ * @brief Turns the tracking of written memory pages on or off (see memory_track_writes).
+ * @param enabled Whether armv8_load should only clear the pages written since the last load.
+ */
+void armv8_set_write_tracking(bool enabled) {
+    memory_track_writes(enabled);
+}
+
+/**
+ * @brief Gets the number of instructions executed since the program was loaded.
+ * @return The count, which includes the iterations skipped by fast-forwarding and excludes the halt.
+ */
+uint64_t armv8_get_instruction_count(void) {
+    return get_instruction_count();
+}
+
+/**
+ * @brief Gets how much fast-forwarding has skipped since the program was loaded.
+ * @param loops Set to the number of loops fast-forwarded.
+ * @param iterations Set to the number of iterations skipped.
+ */
+void armv8_get_fast_forward_stats(uint64_t *loops, uint64_t *iterations) {
+    get_fast_forward_stats(loops, iterations);
+}
+
+/**
+ * @brief Executes a single instruction.
+ * @return false once the halt instruction has been executed or the instruction faults (see
+ *         armv8_error), true otherwise.
+ */
+bool armv8_step(void) {
+    FaultHandler handler;
+    if (fault_catch(&handler) != 0) {
+        keep_error(&handler);
+        return false;
+    }
+    bool running = step_instruction();
+    fault_pop(&handler);
+    return running;
+}
+
+/**
+ * @brief Reads a general register of the emulator.
+ * @param reg_num Number of the register, from 0 to 30.
+ * @return The 64-bit value of the register.
+ */
+uint64_t armv8_get_register(uint32_t reg_num) {
+    return get_reg_value_64(reg_num);
+}
+
+/**
+ * @brief Writes a general register of the emulator.
+ * @param reg_num Number of the register, from 0 to 30.
+ * @param value The 64-bit value to write.
+ */
+void armv8_set_register(uint32_t reg_num, uint64_t value) {
+    set_reg_value(reg_num, value);
+}
+
+/**
+ * @brief Clones the emulator into a child process (see machine_fork).
+ * @return 0 in the child, the process ID of the child in the parent, or -1 if the fork failed.
+ */
+pid_t armv8_fork(void) {
+    return machine_fork();
+}
+
+/**
+ * @brief Reads the program counter of the emulator.
+ * @return The address of the next instruction to execute.
+ */
+uint64_t armv8_get_pc(void) {
+    return get_spec_register(PROGRAM_COUNTER);
+}
+
+/**
+ * @brief Reads a word from the memory of the emulator.
+ * @param address Address of the word.
+ * @param word Set to the 32-bit word at the address.
+ * @return true on success, false if the address is outside memory (see armv8_error).
+ */
+bool armv8_get_word(uint32_t address, uint32_t *word) {
+    FaultHandler handler;
+    if (fault_catch(&handler) != 0) {
+        keep_error(&handler);
+        return false;
+    }
+    *word = get_word(address);
+    fault_pop(&handler);
+    return true;
+}
+
+/**
+ * @brief Writes the emulator state to a stream, in the format of emulate's output file.
+ * @param output_file Stream to write to.
+ */
+void armv8_print_state(FILE *output_file) {
+    write_cpu(output_file);
+}
@@ -0,0 +1,82 @@
+/**
+ * @file armv8.h
+ * @brief Public interface of libarmv8, the assembler and emulator as a library.
+ * @details Lets another program assemble source text held in memory and run the result,
+ *          without temporary files or spawning the command line tools. Build with
+ *          `make lib` and link against bin/libarmv8.a or bin/libarmv8.so.
+ *
+ *          The emulator keeps its state in module globals, so a process has a single emulator
+ *          context: armv8_load replaces whatever program was loaded before.
+ *
+ *          An invalid program never ends the calling process: the functions that take one return
+ *          NULL or false instead, and armv8_error says what was wrong with it.
+ */
+#ifndef ARMV8_H
+#define ARMV8_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+// Assemble source text into a newly allocated buffer of instructions, to be freed with free().
+// Returns NULL if the source is invalid.
+extern uint32_t *armv8_assemble(const char *source, size_t length, size_t *num_instructions);
+
+// Reset the emulator and load a buffer of instructions into memory from address 0.
+// Returns false if the instructions do not fit in memory.
+extern bool armv8_load(const uint32_t *instructions, size_t num_instructions);
+
+// Run the loaded program until it halts, returning false if it faults or reaches the instruction limit first.
+extern bool armv8_run(void);
+
+// Stop armv8_run after about this many instructions, or UINT64_MAX (the default) for no limit.
+extern void armv8_set_instruction_limit(uint64_t limit);
+
+// Turn executing common instruction sequences as one step during armv8_run on or off (on by default).
+// The final state is the same either way.
+extern void armv8_set_fusion(bool enabled);
+
+// Turn skipping the iterations of pure counting loops during armv8_run on or off (off by default).
+// The final state and instruction count are the same either way.
+extern void armv8_set_fast_forward(bool enabled);
+
+// Track which pages of memory each program writes (off by default), so that armv8_load only clears
+// those. Worth it when loading many programs in turn, though it makes stores a little slower.
+extern void armv8_set_write_tracking(bool enabled);
+
+// Number of instructions executed since the program was loaded, skipped loop iterations included.
+extern uint64_t armv8_get_instruction_count(void);
+
+// Number of loops fast-forwarded and of iterations skipped since the program was loaded.
+extern void armv8_get_fast_forward_stats(uint64_t *loops, uint64_t *iterations);
+
+// Execute a single instruction, returning false once the halt instruction has been executed
+// or if the instruction faults.
+extern bool armv8_step(void);
+
+// Message describing why the most recent call that returned NULL or false failed.
+extern const char *armv8_error(void);
+
+// Read general register Xn (0 to 30) of the emulator.
+extern uint64_t armv8_get_register(uint32_t reg_num);
+
+// Write general register Xn (0 to 30) of the emulator, for example to vary the input of a run.
+extern void armv8_set_register(uint32_t reg_num, uint64_t value);
+
+// Clone the emulator into a child process sharing its memory copy-on-write, for exploring several
+// variants from one state. Returns like fork: 0 in the child, its process ID in the parent, or -1.
+extern pid_t armv8_fork(void);
+
+// Read the program counter of the emulator.
+extern uint64_t armv8_get_pc(void);
+
+// Read the word at an address in the memory of the emulator.
+// Returns false if the address is outside memory.
+extern bool armv8_get_word(uint32_t address, uint32_t *word);
+
+// Write the emulator state to a stream, in the format of emulate's output file.
+extern void armv8_print_state(FILE *output_file);
+
+#endif /* ARMV8_H */
@@ -0,0 +1,178 @@
+/**
+ * @file output_buffer.c
+ * @brief Definitions for building text output in memory and writing it out in one go.
+ * @details Used by print_cpu and the debugger. See output_buffer.h.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "output_buffer.h"
+#include "utils.h"
+
+// Initial capacity, enough for the registers and a few hundred memory words
+#define INITIAL_CAPACITY 16384
+// Most decimal digits a uint64_t can have
+#define MAX_DECIMAL_DIGITS 20
+
+struct OutputBuffer {
+    char *data;         // Text so far, with room for a terminating '\0'
+    size_t length;
+    size_t capacity;
+};
+
+// The two lower case hex digits of every byte value, in order
+static const char hex_pairs[] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+/**
+ * @brief Creates a new, empty output buffer.
+ * @return Pointer to the new buffer.
+ */
+OutputBuffer *output_buffer_init(void) {
+    OutputBuffer *ob = malloc(sizeof(OutputBuffer));
+    assert_msg(ob != NULL, "Memory allocation failed\n");
+    ob->data = malloc(INITIAL_CAPACITY);
+    assert_msg(ob->data != NULL, "Memory allocation failed\n");
+    ob->length = 0;
+    ob->capacity = INITIAL_CAPACITY;
+    return ob;
+}
+
+/**
+ * @brief Makes room for some more characters and a terminating '\0', doubling the capacity as needed.
+ */
+static void reserve(OutputBuffer *ob, size_t extra) {
+    if (ob->length + extra < ob->capacity) {
+        return;
+    }
+    while (ob->length + extra >= ob->capacity) {
+        ob->capacity *= 2;
+    }
+    ob->data = realloc(ob->data, ob->capacity);
+    assert_msg(ob->data != NULL, "Memory allocation failed\n");
+}
+
+/**
+ * @brief Appends a null-terminated string.
+ *
+ * @param ob The buffer to append to.
+ * @param text The string to append.
+ */
+void output_buffer_append(OutputBuffer *ob, const char *text) {
+    size_t text_length = strlen(text);
+    reserve(ob, text_length);
+    memcpy(ob->data + ob->length, text, text_length);
+    ob->length += text_length;
+}
+
+/**
+ * @brief Appends a number in lower case hex, zero padded to a fixed number of digits.
+ *
+ * The digits are filled in from the right two at a time, one table lookup per byte.
+ *
+ * @param ob The buffer to append to.
+ * @param value The number, of which only the low digits are written.
+ * @param digits Number of hex digits to write, an even number from 2 to 16.
+ */
+void output_buffer_append_hex(OutputBuffer *ob, uint64_t value, int digits) {
+    reserve(ob, digits);
+    char *position = ob->data + ob->length + digits;
+    for (int i = 0; i < digits; i += 2) {
+        position -= 2;
+        memcpy(position, &hex_pairs[(value & 0xff) * 2], 2);
+        value >>= 8;
+    }
+    ob->length += digits;
+}
+
+/**
+ * @brief Appends a number in decimal, zero padded to a minimum number of digits.
+ *
+ * @param ob The buffer to append to.
+ * @param value The number.
+ * @param min_digits Fewest digits to write, at most MAX_DECIMAL_DIGITS.
+ */
+void output_buffer_append_decimal(OutputBuffer *ob, uint64_t value, int min_digits) {
+    char digits[MAX_DECIMAL_DIGITS];
+    int num_digits = 0;
+    do {
+        digits[MAX_DECIMAL_DIGITS - 1 - num_digits++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (num_digits < min_digits) {
+        digits[MAX_DECIMAL_DIGITS - 1 - num_digits++] = '0';
+    }
+
+    reserve(ob, num_digits);
+    memcpy(ob->data + ob->length, digits + MAX_DECIMAL_DIGITS - num_digits, num_digits);
+    ob->length += num_digits;
+}
+
+/**
+ * @brief Gives the text in the buffer, for passing on to a printf style function.
+ *
+ * @param ob The buffer.
+ * @return The text, null-terminated, valid until the buffer is next changed.
+ */
+const char *output_buffer_contents(OutputBuffer *ob) {
+    ob->data[ob->length] = '\0';
+    return ob->data;
+}
+
+/**
+ * @brief Empties the buffer, keeping its memory for the next text.
+ *
+ * @param ob The buffer.
+ */
+void output_buffer_clear(OutputBuffer *ob) {
+    ob->length = 0;
+}
+
+/**
+ * @brief Writes the text in the buffer to a stream and empties the buffer.
+ *
+ * The stream is flushed first, so that the text comes after anything already printed to it, and
+ * the text then goes straight to its file descriptor with one write call (more only if the
+ * operating system takes part of it). A stream with no file descriptor, such as a memory stream,
+ * gets the text through fwrite instead. A failed write is ignored, as failed printf calls were.
+ *
+ * @param ob The buffer.
+ * @param output_file The stream to write to.
+ */
+void output_buffer_write(OutputBuffer *ob, FILE *output_file) {
+    fflush(output_file);
+    int fd = fileno(output_file);
+    if (fd < 0) {
+        fwrite(ob->data, 1, ob->length, output_file);
+        output_buffer_clear(ob);
+        return;
+    }
+
+    size_t written = 0;
+    while (written < ob->length) {
+        ssize_t result = write(fd, ob->data + written, ob->length - written);
+        if (result <= 0) {
+            break;
+        }
+        written += result;
+    }
+    output_buffer_clear(ob);
+}
+
+/**
+ * @brief Frees the buffer.
+ *
+ * @param ob The buffer to free.
+ */
+void output_buffer_free(OutputBuffer *ob) {
+    free(ob->data);
+    free(ob);
+}
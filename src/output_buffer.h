@@ -0,0 +1,42 @@
+/**
+ * @file output_buffer.h
+ * @brief Declarations for building text output in memory and writing it out in one go.
+ * @details Hex numbers are formatted two digits at a time from a lookup table instead of through
+ *          printf, and the whole text is handed to the operating system with a single write,
+ *          which keeps dumping a large memory image cheap. The text written is exactly what the
+ *          matching printf formats ("%016lx", "%08x", "%02d") would have produced.
+ */
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct OutputBuffer OutputBuffer;
+
+// Creates a new, empty output buffer
+extern OutputBuffer *output_buffer_init(void);
+
+// Appends a null-terminated string
+extern void output_buffer_append(OutputBuffer *ob, const char *text);
+
+// Appends the low digits of a number in lower case hex, zero padded, like "%0<digits>x" (digits must be even)
+extern void output_buffer_append_hex(OutputBuffer *ob, uint64_t value, int digits);
+
+// Appends a number in decimal, zero padded to at least min_digits digits, like "%0<min_digits>d"
+extern void output_buffer_append_decimal(OutputBuffer *ob, uint64_t value, int min_digits);
+
+// Gives the text appended since the buffer was created or last written, null-terminated
+extern const char *output_buffer_contents(OutputBuffer *ob);
+
+// Empties the buffer, keeping its memory for the next text
+extern void output_buffer_clear(OutputBuffer *ob);
+
+// Writes the text to a stream with a single write call (after flushing the stream), then empties the buffer
+extern void output_buffer_write(OutputBuffer *ob, FILE *output_file);
+
+// Frees the buffer
+extern void output_buffer_free(OutputBuffer *ob);
+
+#endif /* OUTPUT_BUFFER_H */
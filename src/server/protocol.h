@@ -0,0 +1,47 @@
+/**
+ * @file protocol.h
+ * @brief Wire format spoken over the Unix domain socket of the assembler/emulator server.
+ * @details Every message is a fixed header of two native endian uint32_t fields followed by a
+ *          payload of the given length. A client may send any number of requests over one
+ *          connection, and every request is answered by exactly one response, in order.
+ *
+ *          Request payloads:
+ *          - SERVER_ASSEMBLE: assembly source text. Responds with the flat binary image.
+ *          - SERVER_EMULATE: flat binary image. Responds with the final CPU state as text,
+ *            exactly as `emulate` would write it to its output file.
+ *          - SERVER_ASSEMBLE_EMULATE: assembly source text. Responds as SERVER_EMULATE would
+ *            for the assembled image.
+ *
+ *          A response with a status other than SERVER_OK carries an error message as its payload,
+ *          as does an emulate request whose program runs past the server's instruction limit.
+ */
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+
+// Largest payload the server accepts in a request
+#define SERVER_MAX_PAYLOAD (1 << 24)
+
+typedef enum {
+    SERVER_ASSEMBLE = 1,
+    SERVER_EMULATE = 2,
+    SERVER_ASSEMBLE_EMULATE = 3,
+} RequestType;
+
+typedef enum {
+    SERVER_OK = 0,
+    SERVER_BAD_REQUEST = 1,
+} ResponseStatus;
+
+typedef struct {
+    uint32_t type;    // RequestType
+    uint32_t length;  // Number of payload bytes following the header
+} RequestHeader;
+
+typedef struct {
+    uint32_t status;  // ResponseStatus
+    uint32_t length;  // Number of payload bytes following the header
+} ResponseHeader;
+
+#endif /* PROTOCOL_H */
@@ -0,0 +1,239 @@
+/**
+ * @file server.c
+ * @brief Source file for the "server" executable, a long running assembler and emulator.
+ * @details Listens on a Unix domain socket and answers assemble, emulate and assemble+emulate
+ *          requests in the format described in protocol.h. Running many small programs this way
+ *          avoids paying for process start up on every one of them, and the request buffer is
+ *          kept between requests rather than allocated each time.
+ *
+ *          Requests are served one at a time, since the assembler and emulator keep their state
+ *          in module globals.
+ *          A program that fails to assemble, faults while running or runs past the instruction
+ *          limit gets an error response, and the server carries on with the next request.
+ *          The limit keeps a program that never halts from holding up every other client.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "protocol.h"
+#include "../utils.h"
+#include "../lib/armv8.h"
+
+#define BACKLOG 16
+// Instructions a program may run per request unless --max-instructions says otherwise
+#define DEFAULT_INSTRUCTION_LIMIT 100000000
+
+static char *payload;             // Payload of the current request, kept between requests
+static size_t payload_capacity;   // Number of bytes allocated for payload
+
+/**
+ * @brief Reads exactly the given number of bytes from a socket.
+ * @return true on success, false if the connection was closed or failed part way.
+ */
+static bool read_fully(int fd, void *buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t result = read(fd, (char *) buffer + done, length - done);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        done += result;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes exactly the given number of bytes to a socket.
+ * @return true on success, false if the connection was closed or failed part way.
+ */
+static bool write_fully(int fd, const void *buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t result = write(fd, (const char *) buffer + done, length - done);
+        if (result < 0 && errno == EINTR) continue;
+        if (result <= 0) return false;
+        done += result;
+    }
+    return true;
+}
+
+/**
+ * @brief Sends a response header followed by its payload.
+ * @return true on success, false if the connection failed.
+ */
+static bool send_response(int fd, ResponseStatus status, const void *data, size_t length) {
+    ResponseHeader header = {status, length};
+    return write_fully(fd, &header, sizeof(header)) && write_fully(fd, data, length);
+}
+
+/**
+ * @brief Sends an error response with a message as its payload.
+ * @return true on success, false if the connection failed.
+ */
+static bool send_error(int fd, const char *message) {
+    return send_response(fd, SERVER_BAD_REQUEST, message, strlen(message));
+}
+
+/**
+ * @brief Runs a program held in memory and sends back the final CPU state.
+ * @return true on success, false if the connection failed.
+ */
+static bool emulate_and_respond(int fd, const uint32_t *instructions, size_t num_instructions) {
+    if (!armv8_load(instructions, num_instructions) || !armv8_run()) {
+        return send_error(fd, armv8_error());
+    }
+
+    char *output;
+    size_t output_length;
+    FILE *output_file = open_memstream(&output, &output_length);
+    assert_msg(output_file != NULL, "Failed to open output stream\n");
+    armv8_print_state(output_file);
+    fclose(output_file);
+
+    bool sent = send_response(fd, SERVER_OK, output, output_length);
+    free(output);
+    return sent;
+}
+
+/**
+ * @brief Carries out one request whose payload has been read into `payload`.
+ * @return true if the response was sent, false if the connection failed.
+ */
+static bool handle_request(int fd, RequestType type, size_t length) {
+    switch (type) {
+        case SERVER_ASSEMBLE: {
+            size_t num_instructions;
+            uint32_t *words = armv8_assemble(payload, length, &num_instructions);
+            if (words == NULL) {
+                return send_error(fd, armv8_error());
+            }
+            bool sent = send_response(fd, SERVER_OK, words, num_instructions * sizeof(uint32_t));
+            free(words);
+            return sent;
+        }
+        case SERVER_EMULATE: {
+            if (length % sizeof(uint32_t) != 0) {
+                return send_error(fd, "Binary image is not a whole number of instructions\n");
+            }
+            // The payload buffer comes from malloc, so it is suitably aligned for uint32_t
+            return emulate_and_respond(fd, (uint32_t *) payload, length / sizeof(uint32_t));
+        }
+        case SERVER_ASSEMBLE_EMULATE: {
+            size_t num_instructions;
+            uint32_t *words = armv8_assemble(payload, length, &num_instructions);
+            if (words == NULL) {
+                return send_error(fd, armv8_error());
+            }
+            bool sent = emulate_and_respond(fd, words, num_instructions);
+            free(words);
+            return sent;
+        }
+        default:
+            return send_error(fd, "Unknown request type\n");
+    }
+}
+
+/**
+ * @brief Answers requests on a connection until the client closes it.
+ * @param fd Socket of the connection.
+ */
+static void serve_connection(int fd) {
+    RequestHeader header;
+
+    while (read_fully(fd, &header, sizeof(header))) {
+        if (header.length > SERVER_MAX_PAYLOAD) {
+            send_error(fd, "Request payload too large\n");
+            return;
+        }
+
+        // Grow the payload buffer only when a request needs more room than any before it
+        if (header.length > payload_capacity) {
+            char *grown = realloc(payload, header.length);
+            assert_msg(grown != NULL, "Memory allocation failed\n");
+            payload = grown;
+            payload_capacity = header.length;
+        }
+
+        if (!read_fully(fd, payload, header.length) || !handle_request(fd, header.type, header.length)) {
+            return;
+        }
+    }
+}
+
+/**
+ * Main function for the assembler and emulator server.
+ *
+ * Creates a Unix domain socket at the given path (replacing any stale socket there) and serves
+ * connections on it one after another until the process is killed. "--max-instructions N" before
+ * the path sets how many instructions a program may run per request (DEFAULT_INSTRUCTION_LIMIT
+ * otherwise).
+ *
+ * @param argc Number of command-line arguments.
+ * @param argv Array of command-line argument strings containing the options and the socket path.
+ * @return EXIT_FAILURE if the socket could not be set up, otherwise does not return.
+ */
+int main(int argc, char **argv) {
+    uint64_t instruction_limit = DEFAULT_INSTRUCTION_LIMIT;
+    int arg_index = 1;
+    if (argc == 4 && strcmp(argv[1], "--max-instructions") == 0) {
+        char *end;
+        instruction_limit = strtoull(argv[2], &end, 10);
+        if (argv[2][0] == '\0' || argv[2][0] == '-' || *end != '\0') {
+            fprintf(stderr, "Invalid value %s for --max-instructions\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+        arg_index = 3;
+    }
+    if (argc - arg_index != 1) {
+        fprintf(stderr, "Usage: ./server [--max-instructions N] socket-path\n");
+        return EXIT_FAILURE;
+    }
+    armv8_set_instruction_limit(instruction_limit);
+    // Every request loads a new program, so only clear the memory the last one wrote
+    armv8_set_write_tracking(true);
+
+    const char *socket_path = argv[arg_index];
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", socket_path);
+        return EXIT_FAILURE;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    // A client disconnecting mid-response should end that connection, not the server
+    signal(SIGPIPE, SIG_IGN);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    assert_msg(listen_fd != -1, "Failed to create socket\n");
+
+    // Remove a socket left behind by an earlier server, but never any other kind of file
+    struct stat status;
+    if (lstat(socket_path, &status) == 0) {
+        if (!S_ISSOCK(status.st_mode)) {
+            fprintf(stderr, "%s exists and is not a socket\n", socket_path);
+            return EXIT_FAILURE;
+        }
+        unlink(socket_path);
+    }
+    if (bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) == -1 || listen(listen_fd, BACKLOG) == -1) {
+        fprintf(stderr, "Failed to listen on socket %s\n", socket_path);
+        return EXIT_FAILURE;
+    }
+
+    while (true) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd == -1) {
+            continue;
+        }
+
+        serve_connection(fd);
+        close(fd);
+    }
+}
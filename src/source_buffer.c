@@ -0,0 +1,161 @@
+/**
+ * @file source_buffer.c
+ * @brief Definitions for reading a whole source file into memory and iterating over its lines.
+ * @details Both the assembler and the debugger read their input through this file. The whole file
+ *          is pulled in with one bulk read and lines are found with memchr, which the C library
+ *          vectorises, instead of reading the file one character at a time.
+ */
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "source_buffer.h"
+#include "utils.h"
+
+// Smallest capacity to start reading into, for files whose size is not known up front
+#define MIN_CAPACITY 4096
+
+struct SourceBuffer {
+    char *contents;  // Whole file, followed by a terminating '\0'
+    char *cursor;    // Start of the next line to hand out
+    char *end;       // One past the last character of the file
+};
+
+/**
+ * @brief Reads the entire file at the given path into a new source buffer.
+ *
+ * The size of the file is queried up front as the first guess at the capacity, so a regular file
+ * is read with a single allocation and (usually) a single read call. Pipes and character devices
+ * report a size of 0, so the buffer grows by doubling until read reports the end of the file.
+ *
+ * @param file_path Path to the file to read.
+ * @return Pointer to the new source buffer.
+ *
+ * @note The function exits the program with a failure status if the file cannot be opened or read.
+ */
+SourceBuffer *source_buffer_open(const char *file_path) {
+    int fd = open(file_path, O_RDONLY);
+    if (fd == -1) {
+        fprintf(stderr, "Failed to open file %s\n", file_path);
+        exit(EXIT_FAILURE);
+    }
+
+    struct stat file_stat;
+    assert_msg(fstat(fd, &file_stat) == 0, "Failed to read size of file %s\n", file_path);
+    // One more than the size, so that reaching the end of a regular file needs no extra allocation
+    size_t capacity = file_stat.st_size + 1;
+    if (capacity < MIN_CAPACITY) {
+        capacity = MIN_CAPACITY;
+    }
+
+    SourceBuffer *sb = malloc(sizeof(SourceBuffer));
+    assert_msg(sb != NULL, "Memory allocation failed\n");
+
+    sb->contents = malloc(capacity);
+    assert_msg(sb->contents != NULL, "Memory allocation failed\n");
+
+    // read may return fewer bytes than requested, so keep going until it reports the end of the file
+    size_t length = 0;
+    while (true) {
+        if (length == capacity - 1) {
+            capacity *= 2;
+            sb->contents = realloc(sb->contents, capacity);
+            assert_msg(sb->contents != NULL, "Memory allocation failed\n");
+        }
+        ssize_t result = read(fd, sb->contents + length, capacity - 1 - length);
+        assert_msg(result >= 0, "Failed to read from file %s\n", file_path);
+        if (result == 0) {
+            break;
+        }
+        length += result;
+    }
+    close(fd);
+
+    sb->contents[length] = '\0';
+    sb->cursor = sb->contents;
+    sb->end    = sb->contents + length;
+
+    return sb;
+}
+
+/**
+ * @brief Copies a block of text that is already in memory into a new source buffer.
+ *
+ * @param contents Text to copy, which does not need to be null-terminated.
+ * @param length Number of characters to copy.
+ * @return Pointer to the new source buffer.
+ */
+SourceBuffer *source_buffer_from_string(const char *contents, size_t length) {
+    SourceBuffer *sb = malloc(sizeof(SourceBuffer));
+    assert_msg(sb != NULL, "Memory allocation failed\n");
+
+    sb->contents = malloc(length + 1);
+    assert_msg(sb->contents != NULL, "Memory allocation failed\n");
+
+    memcpy(sb->contents, contents, length);
+    sb->contents[length] = '\0';
+    sb->cursor = sb->contents;
+    sb->end    = sb->contents + length;
+
+    return sb;
+}
+
+/**
+ * @brief Iterates through the lines of the buffer.
+ *
+ * The newline ending each line is overwritten with '\0' so the line can be used as a regular
+ * string. A final line without a trailing newline is still returned.
+ *
+ * @param sb Source buffer to iterate over.
+ * @param pline Pointer to store the next line (updated by reference).
+ * @return true if a line was retrieved, false once the end of the buffer has been reached.
+ */
+bool source_buffer_next_line(SourceBuffer *sb, char **pline) {
+    assert_msg(sb != NULL, "Source buffer pointer passed in is null.\n");
+
+    if (sb->cursor == sb->end) {
+        return false;
+    }
+
+    char *line = sb->cursor;
+    char *newline = memchr(line, '\n', sb->end - line);
+
+    if (newline == NULL) { //last line did not end with \n
+        sb->cursor = sb->end;
+    } else {
+        *newline = '\0';
+        sb->cursor = newline + 1;
+    }
+
+    *pline = line;
+    return true;
+}
+
+/**
+ * @brief Gives access to the raw contents of the buffer.
+ *
+ * Only meaningful before iterating over lines, since iteration overwrites newlines with '\0'.
+ *
+ * @param sb Source buffer to read.
+ * @param plength Pointer to store the number of bytes in the buffer (updated by reference).
+ * @return Pointer to the first byte of the buffer.
+ */
+const char *source_buffer_contents(const SourceBuffer *sb, size_t *plength) {
+    assert_msg(sb != NULL, "Source buffer pointer passed in is null.\n");
+
+    *plength = sb->end - sb->contents;
+    return sb->contents;
+}
+
+/**
+ * @brief Frees the source buffer along with its contents.
+ * @param sb Source buffer to free.
+ */
+void source_buffer_free(SourceBuffer *sb) {
+    assert_msg(sb != NULL, "Source buffer pointer passed in is null.\n");
+
+    free(sb->contents);
+    free(sb);
+}
@@ -0,0 +1,31 @@
+/**
+ * @file source_buffer.h
+ * @brief Declarations for reading a whole source file into memory and iterating over its lines.
+ * @details The file is read with a single bulk read and split into lines in place, so every
+ *          line handed out is a null-terminated view into the buffer rather than a fresh copy.
+ *          Views stay valid (and writeable) until the buffer is freed.
+ */
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct SourceBuffer SourceBuffer;
+
+// Reads the entire file at the given path into a new source buffer
+extern SourceBuffer *source_buffer_open(const char *file_path);
+
+// Copies text that is already in memory into a new source buffer
+extern SourceBuffer *source_buffer_from_string(const char *contents, size_t length);
+
+// Iterates through the lines of the buffer, returning false once every line has been read
+extern bool source_buffer_next_line(SourceBuffer *sb, char **pline);
+
+// Gives access to the raw bytes of the buffer, before any lines have been read
+extern const char *source_buffer_contents(const SourceBuffer *sb, size_t *plength);
+
+// Frees the buffer and invalidates every line view handed out from it
+extern void source_buffer_free(SourceBuffer *sb);
+
+#endif /* SOURCE_BUFFER_H */
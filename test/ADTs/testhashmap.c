@@ -103,6 +103,32 @@ void test_large_input_for_each() {
     free(c);
 }
 
+static void sum_values(const char *key, void *value, void *state) {
+    *(int *) state += *(int *) value;
+}
+
+void test_for_each_visits_every_item() {
+    int test_size = 100;
+    int expected_sum = 0;
+
+    char *c = malloc(sizeof(char) * 4);
+    for (int i = 0; i < test_size; i++) {
+        int *num = malloc(sizeof(int));
+        assert(num != NULL);
+
+        *num = i;
+        expected_sum += i;
+        c = int_to_str(i, c);
+        hashmap_set(hmap, c, num);
+    }
+
+    int sum = 0;
+    hashmap_for_each(hmap, sum_values, &sum);
+    TEST_ASSERT_EQUAL(expected_sum, sum);
+
+    free(c);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
@@ -113,5 +139,6 @@ int main(void)
     RUN_TEST(test_get_returns_latest_value);
     RUN_TEST(test_remove_returns_correct_value);
     RUN_TEST(test_large_input_for_each);
+    RUN_TEST(test_for_each_visits_every_item);
     return UNITY_END();
 }
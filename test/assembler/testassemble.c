@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../Unity/src/unity.h"
+
+// Tests are run from test/bin, so the assembler is two directories up
+#define ASSEMBLER "../../bin/assemble"
+#define MAX_OUTPUT_SIZE 1024
+#define MAX_PATH_SIZE 128
+#define MAX_COMMAND_SIZE 512
+
+// Lines with no code, which take up no instruction slot, around a small loop
+static const char *source =
+    "// comment only\n"
+    "movz x1, #3\n"
+    "\n"
+    "   \n"
+    " , ,\n"
+    "  / indented comment\n"
+    "loop:\n"
+    "subs x1, x1, #1 // trailing comment\n"
+    "\n"
+    "b.ne loop\n"
+    "//\n"
+    "movz x2, #7\n"
+    "and x0, x0, x0\n";
+
+static char directory[MAX_PATH_SIZE / 2];
+static char input_path[MAX_PATH_SIZE];
+
+void setUp(void) {
+    strcpy(directory, "/tmp/testassembleXXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+
+    snprintf(input_path, MAX_PATH_SIZE, "%s/input.s", directory);
+    FILE *input = fopen(input_path, "w");
+    TEST_ASSERT_NOT_NULL(input);
+    fputs(source, input);
+    fclose(input);
+}
+
+void tearDown(void) {
+    char command[MAX_COMMAND_SIZE];
+    snprintf(command, MAX_COMMAND_SIZE, "rm -rf %s", directory);
+    system(command);
+}
+
+/**
+ * @brief Assembles the test source with the given options and reads back the output.
+ *
+ * @return The size of the output in bytes.
+ */
+static size_t assemble_with(const char *options, uint8_t *output) {
+    char output_path[MAX_PATH_SIZE], command[MAX_COMMAND_SIZE];
+    snprintf(output_path, MAX_PATH_SIZE, "%s/output.bin", directory);
+    snprintf(command, MAX_COMMAND_SIZE, ASSEMBLER " %s %s %s", options, input_path, output_path);
+    TEST_ASSERT_EQUAL(0, system(command));
+
+    FILE *output_file = fopen(output_path, "rb");
+    TEST_ASSERT_NOT_NULL(output_file);
+    size_t size = fread(output, 1, MAX_OUTPUT_SIZE, output_file);
+    fclose(output_file);
+    remove(output_path);
+    return size;
+}
+
+void test_serial_skips_lines_without_code() {
+    uint8_t output[MAX_OUTPUT_SIZE];
+    TEST_ASSERT_EQUAL(5 * sizeof(uint32_t), assemble_with("", output));
+}
+
+void test_parallel_matches_serial() {
+    uint8_t serial[MAX_OUTPUT_SIZE], parallel[MAX_OUTPUT_SIZE];
+    size_t serial_size = assemble_with("", serial);
+
+    // With more threads than instructions, some chunks are empty
+    const char *thread_options[] = {"-j 2", "-j 3", "-j 8", "-j 16"};
+    for (int i = 0; i < 4; i++) {
+        size_t parallel_size = assemble_with(thread_options[i], parallel);
+        TEST_ASSERT_EQUAL(serial_size, parallel_size);
+        TEST_ASSERT_EQUAL(0, memcmp(serial, parallel, serial_size));
+    }
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_serial_skips_lines_without_code);
+    RUN_TEST(test_parallel_matches_serial);
+    return UNITY_END();
+}
@@ -0,0 +1,167 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../Unity/src/unity.h"
+#include "../../src/assembler/cache.h"
+
+// Tests are run from test/bin, so the assembler is two directories up
+#define ASSEMBLER "../../bin/assemble"
+#define MAX_OUTPUT_SIZE 1024
+#define MAX_PATH_SIZE 128
+#define MAX_COMMAND_SIZE 512
+
+static const char *source =
+    "movz x1, #3\n"
+    "loop:\n"
+    "subs x1, x1, #1\n"
+    "b.ne loop\n"
+    "and x0, x0, x0\n";
+
+static char directory[MAX_PATH_SIZE / 2];
+static char source_path[MAX_PATH_SIZE];
+static char cache_dir[MAX_PATH_SIZE];
+
+/**
+ * @brief Writes some text to a file, replacing anything in it.
+ */
+static void write_file(const char *path, const char *content) {
+    FILE *file = fopen(path, "w");
+    TEST_ASSERT_NOT_NULL(file);
+    fputs(content, file);
+    fclose(file);
+}
+
+/**
+ * @brief Reads a whole file into a buffer of MAX_OUTPUT_SIZE bytes.
+ *
+ * @return The size of the file in bytes.
+ */
+static size_t read_file(const char *path, char *content) {
+    FILE *file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    size_t size = fread(content, 1, MAX_OUTPUT_SIZE, file);
+    fclose(file);
+    return size;
+}
+
+/**
+ * @brief Counts the entries in the cache directory.
+ */
+static int count_entries(void) {
+    DIR *dir = opendir(cache_dir);
+    TEST_ASSERT_NOT_NULL(dir);
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+void setUp(void) {
+    strcpy(directory, "/tmp/testcacheXXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+    snprintf(source_path, MAX_PATH_SIZE, "%s/input.s", directory);
+    snprintf(cache_dir, MAX_PATH_SIZE, "%s/cache", directory);
+    write_file(source_path, source);
+}
+
+void tearDown(void) {
+    char command[MAX_COMMAND_SIZE];
+    snprintf(command, MAX_COMMAND_SIZE, "rm -rf %s", directory);
+    system(command);
+}
+
+void test_miss_then_hit() {
+    char output_path[MAX_PATH_SIZE], output[MAX_OUTPUT_SIZE];
+    snprintf(output_path, MAX_PATH_SIZE, "%s/output.bin", directory);
+
+    char *entry_path = cache_entry_path(cache_dir, source_path, false);
+    TEST_ASSERT_FALSE(cache_lookup(entry_path, output_path));
+
+    write_file(output_path, "assembled");
+    cache_store(cache_dir, entry_path, output_path);
+    remove(output_path);
+
+    TEST_ASSERT_TRUE(cache_lookup(entry_path, output_path));
+    size_t size = read_file(output_path, output);
+    TEST_ASSERT_EQUAL(strlen("assembled"), size);
+    TEST_ASSERT_EQUAL(0, memcmp("assembled", output, size));
+    TEST_ASSERT_EQUAL(1, count_entries());
+    free(entry_path);
+}
+
+void test_one_byte_change_misses() {
+    char output_path[MAX_PATH_SIZE];
+    snprintf(output_path, MAX_PATH_SIZE, "%s/output.bin", directory);
+
+    char *entry_path = cache_entry_path(cache_dir, source_path, false);
+    write_file(output_path, "assembled");
+    cache_store(cache_dir, entry_path, output_path);
+
+    // movz x1, #3 becomes movz x1, #4
+    char changed[MAX_OUTPUT_SIZE];
+    strcpy(changed, source);
+    changed[strlen("movz x1, #")] = '4';
+    write_file(source_path, changed);
+
+    char *changed_entry_path = cache_entry_path(cache_dir, source_path, false);
+    TEST_ASSERT_TRUE(strcmp(entry_path, changed_entry_path) != 0);
+    TEST_ASSERT_FALSE(cache_lookup(changed_entry_path, output_path));
+
+    free(entry_path);
+    free(changed_entry_path);
+}
+
+void test_object_and_image_entries_differ() {
+    char *image_entry_path = cache_entry_path(cache_dir, source_path, false);
+    char *object_entry_path = cache_entry_path(cache_dir, source_path, true);
+    TEST_ASSERT_TRUE(strcmp(image_entry_path, object_entry_path) != 0);
+    free(image_entry_path);
+    free(object_entry_path);
+}
+
+void test_assemble_with_cache() {
+    char command[MAX_COMMAND_SIZE], path[MAX_PATH_SIZE];
+    char uncached[MAX_OUTPUT_SIZE], first[MAX_OUTPUT_SIZE], second[MAX_OUTPUT_SIZE], object[MAX_OUTPUT_SIZE];
+
+    snprintf(command, MAX_COMMAND_SIZE, ASSEMBLER " %s %s/uncached.bin", source_path, directory);
+    TEST_ASSERT_EQUAL(0, system(command));
+    for (int i = 0; i < 2; i++) {
+        snprintf(command, MAX_COMMAND_SIZE, ASSEMBLER " --cache-dir %s %s %s/%s.bin",
+                 cache_dir, source_path, directory, i == 0 ? "first" : "second");
+        TEST_ASSERT_EQUAL(0, system(command));
+    }
+    TEST_ASSERT_EQUAL(1, count_entries());
+
+    snprintf(path, MAX_PATH_SIZE, "%s/uncached.bin", directory);
+    size_t uncached_size = read_file(path, uncached);
+    snprintf(path, MAX_PATH_SIZE, "%s/first.bin", directory);
+    TEST_ASSERT_EQUAL(uncached_size, read_file(path, first));
+    snprintf(path, MAX_PATH_SIZE, "%s/second.bin", directory);
+    TEST_ASSERT_EQUAL(uncached_size, read_file(path, second));
+    TEST_ASSERT_EQUAL(0, memcmp(uncached, first, uncached_size));
+    TEST_ASSERT_EQUAL(0, memcmp(uncached, second, uncached_size));
+
+    // A relocatable object of the same source gets an entry of its own
+    snprintf(command, MAX_COMMAND_SIZE, ASSEMBLER " -c --cache-dir %s %s %s/object.o", cache_dir, source_path, directory);
+    TEST_ASSERT_EQUAL(0, system(command));
+    TEST_ASSERT_EQUAL(2, count_entries());
+    snprintf(path, MAX_PATH_SIZE, "%s/object.o", directory);
+    size_t object_size = read_file(path, object);
+    TEST_ASSERT_TRUE(object_size != uncached_size || memcmp(object, uncached, object_size) != 0);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_miss_then_hit);
+    RUN_TEST(test_one_byte_change_misses);
+    RUN_TEST(test_object_and_image_entries_differ);
+    RUN_TEST(test_assemble_with_cache);
+    return UNITY_END();
+}
@@ -0,0 +1,68 @@
+#include "../Unity/src/unity.h"
+#include "../../src/assembler/disassembler.h"
+
+static char line[DISASSEMBLY_LINE_SIZE];
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+void test_data_processing() {
+    disassemble_instruction(0xd2800201, 0, line);
+    TEST_ASSERT_EQUAL_STRING("movz x1, #0x10", line);
+
+    disassemble_instruction(0xaa0203e1, 0, line);
+    TEST_ASSERT_EQUAL_STRING("mov x1, x2", line);
+
+    disassemble_instruction(0xeb02003f, 0, line);
+    TEST_ASSERT_EQUAL_STRING("cmp x1, x2", line);
+
+    disassemble_instruction(0x9b027c20, 0, line);
+    TEST_ASSERT_EQUAL_STRING("mul x0, x1, x2", line);
+
+    disassemble_instruction(0x8a000000, 0, line);
+    TEST_ASSERT_EQUAL_STRING("and x0, x0, x0", line);
+}
+
+void test_data_transfer() {
+    disassemble_instruction(0xf9000aa1, 0, line);
+    TEST_ASSERT_EQUAL_STRING("str x1, [x21, #16]", line);
+
+    disassemble_instruction(0xf85f8c22, 0, line);
+    TEST_ASSERT_EQUAL_STRING("ldr x2, [x1, #-8]!", line);
+
+    disassemble_instruction(0xf8636841, 0, line);
+    TEST_ASSERT_EQUAL_STRING("ldr x1, [x2, x3]", line);
+}
+
+void test_branch_targets() {
+    uint32_t target;
+
+    disassemble_instruction(0x54ffffc1, 0x20, line);
+    TEST_ASSERT_EQUAL_STRING("b.ne L18", line);
+    TEST_ASSERT_TRUE(disassemble_target(0x54ffffc1, 0x20, &target));
+    TEST_ASSERT_EQUAL_UINT32(0x18, target);
+
+    disassemble_instruction(0xd61f0020, 0, line);
+    TEST_ASSERT_EQUAL_STRING("br x1", line);
+    TEST_ASSERT_FALSE(disassemble_target(0xd61f0020, 0, &target));
+}
+
+void test_unknown_word() {
+    disassemble_instruction(0xdeadbeef, 0, line);
+    TEST_ASSERT_EQUAL_STRING(".int 0xdeadbeef", line);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_data_processing);
+    RUN_TEST(test_data_transfer);
+    RUN_TEST(test_branch_targets);
+    RUN_TEST(test_unknown_word);
+    return UNITY_END();
+}
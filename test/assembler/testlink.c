@@ -0,0 +1,151 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../Unity/src/unity.h"
+
+// Tests are run from test/bin, so the tools are two directories up
+#define ASSEMBLER "../../bin/assemble"
+#define LINKER "../../bin/link"
+#define MAX_OUTPUT_SIZE 1024
+#define MAX_PATH_SIZE 128
+#define MAX_COMMAND_SIZE 512
+
+// Two modules that each use their own local label loop, with the first branching into the second
+static const char *first_module =
+    "movz x1, #3\n"
+    "loop:\n"
+    "subs x1, x1, #1\n"
+    "b.ne loop\n"
+    "b count\n";
+
+static const char *second_module =
+    "count:\n"
+    "movz x2, #2\n"
+    "loop:\n"
+    "subs x2, x2, #1\n"
+    "b.ne loop\n"
+    "and x0, x0, x0\n";
+
+// Both modules in one file, with the second loop renamed so that no label is defined twice
+static const char *whole_source =
+    "movz x1, #3\n"
+    "loop:\n"
+    "subs x1, x1, #1\n"
+    "b.ne loop\n"
+    "b count\n"
+    "count:\n"
+    "movz x2, #2\n"
+    "count_loop:\n"
+    "subs x2, x2, #1\n"
+    "b.ne count_loop\n"
+    "and x0, x0, x0\n";
+
+static char directory[MAX_PATH_SIZE / 2];
+
+void setUp(void) {
+    strcpy(directory, "/tmp/testlinkXXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(directory));
+}
+
+void tearDown(void) {
+    char command[MAX_COMMAND_SIZE];
+    snprintf(command, MAX_COMMAND_SIZE, "rm -rf %s", directory);
+    system(command);
+}
+
+/**
+ * @brief Writes some content to a file in the test directory, setting path to its path.
+ */
+static void write_file(const char *name, const void *content, size_t size, char *path) {
+    snprintf(path, MAX_PATH_SIZE, "%s/%s", directory, name);
+    FILE *file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL(size, fwrite(content, 1, size, file));
+    fclose(file);
+}
+
+/**
+ * @brief Runs a command, returning its exit status, or -1 if it did not exit normally.
+ */
+static int run(const char *command) {
+    int status = system(command);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/**
+ * @brief Reads a whole file into a buffer of MAX_OUTPUT_SIZE bytes.
+ *
+ * @return The size of the file in bytes.
+ */
+static size_t read_file(const char *path, uint8_t *content) {
+    FILE *file = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    size_t size = fread(content, 1, MAX_OUTPUT_SIZE, file);
+    fclose(file);
+    return size;
+}
+
+void test_link_matches_single_file() {
+    char first_path[MAX_PATH_SIZE], second_path[MAX_PATH_SIZE], whole_path[MAX_PATH_SIZE];
+    write_file("first.s", first_module, strlen(first_module), first_path);
+    write_file("second.s", second_module, strlen(second_module), second_path);
+    write_file("whole.s", whole_source, strlen(whole_source), whole_path);
+
+    char command[MAX_COMMAND_SIZE];
+    snprintf(command, MAX_COMMAND_SIZE, ASSEMBLER " %s %s/whole.bin", whole_path, directory);
+    TEST_ASSERT_EQUAL(0, run(command));
+    snprintf(command, MAX_COMMAND_SIZE, ASSEMBLER " -c %s %s/first.o && " ASSEMBLER " -c %s %s/second.o",
+             first_path, directory, second_path, directory);
+    TEST_ASSERT_EQUAL(0, run(command));
+    snprintf(command, MAX_COMMAND_SIZE, LINKER " %s/linked.bin %s/first.o %s/second.o", directory, directory, directory);
+    TEST_ASSERT_EQUAL(0, run(command));
+
+    uint8_t whole[MAX_OUTPUT_SIZE], linked[MAX_OUTPUT_SIZE];
+    char path[MAX_PATH_SIZE];
+    snprintf(path, MAX_PATH_SIZE, "%s/whole.bin", directory);
+    size_t whole_size = read_file(path, whole);
+    snprintf(path, MAX_PATH_SIZE, "%s/linked.bin", directory);
+    size_t linked_size = read_file(path, linked);
+
+    TEST_ASSERT_EQUAL(8 * sizeof(uint32_t), whole_size);
+    TEST_ASSERT_EQUAL(whole_size, linked_size);
+    TEST_ASSERT_EQUAL(0, memcmp(whole, linked, whole_size));
+}
+
+void test_undefined_reference() {
+    char first_path[MAX_PATH_SIZE], command[MAX_COMMAND_SIZE];
+    write_file("first.s", first_module, strlen(first_module), first_path);
+    snprintf(command, MAX_COMMAND_SIZE, ASSEMBLER " -c %s %s/first.o && " LINKER " %s/linked.bin %s/first.o 2> /dev/null",
+             first_path, directory, directory, directory);
+    TEST_ASSERT_EQUAL(1, run(command));
+}
+
+void test_relocation_outside_object() {
+    // One halt instruction and a relocation far past it, all fields little endian
+    uint8_t object[] = {
+        0x41, 0x4f, 0x42, 0x4a, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+        0x00, 0x00, 0x00, 0x8a,
+        0xf0, 0xff, 0xff, 0x7f, 1, 0, 0, 0, 'f'
+    };
+    char object_path[MAX_PATH_SIZE], command[MAX_COMMAND_SIZE];
+    write_file("bad.o", object, sizeof(object), object_path);
+    snprintf(command, MAX_COMMAND_SIZE, LINKER " %s/linked.bin %s 2> /dev/null", directory, object_path);
+    TEST_ASSERT_EQUAL(1, run(command));
+
+    // An unaligned relocation within the instructions is rejected too
+    object[24] = 2;
+    object[25] = object[26] = object[27] = 0;
+    write_file("bad.o", object, sizeof(object), object_path);
+    TEST_ASSERT_EQUAL(1, run(command));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_link_matches_single_file);
+    RUN_TEST(test_undefined_reference);
+    RUN_TEST(test_relocation_outside_object);
+    return UNITY_END();
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../Unity/src/unity.h"
+#include "../../src/assembler/object.h"
+
+static char object_path[] = "/tmp/testobjectXXXXXX";
+
+void setUp(void) {
+    strcpy(object_path, "/tmp/testobjectXXXXXX");
+    int fd = mkstemp(object_path);
+    TEST_ASSERT_TRUE(fd != -1);
+    fclose(fdopen(fd, "w"));
+}
+
+void tearDown(void) {
+    remove(object_path);
+}
+
+/**
+ * @brief Checks that an entry has the expected label and address.
+ */
+static void check_entry(DArray *entries, int index, const char *label, uint32_t address) {
+    ObjectEntry *entry = darray_get(entries, index);
+    TEST_ASSERT_EQUAL_STRING(label, entry->label);
+    TEST_ASSERT_EQUAL_UINT32(address, entry->address);
+}
+
+void test_write_then_read() {
+    DArray *instructions = darray_init(free);
+    uint32_t words[] = {0xd28000a1, 0xf1000421, 0x54ffffe1, 0x14000000, 0x8a000000};
+    for (int i = 0; i < 5; i++) {
+        uint32_t *word = malloc(sizeof(uint32_t));
+        *word = words[i];
+        darray_add(instructions, word);
+    }
+
+    ObjectFile *object = object_init();
+    object_add_instructions(object, instructions);
+    object_add_symbol(object, "loop", 4);
+    object_add_symbol(object, "end", 20);
+    object_add_relocation(object, "func", 12);
+    object_write(object, object_path);
+    object_free(object);
+    darray_free(instructions);
+
+    object = object_read(object_path);
+    TEST_ASSERT_EQUAL(5, darray_length(object->instructions));
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_UINT32(words[i], *(uint32_t *) darray_get(object->instructions, i));
+    }
+    TEST_ASSERT_EQUAL(2, darray_length(object->symbols));
+    check_entry(object->symbols, 0, "loop", 4);
+    check_entry(object->symbols, 1, "end", 20);
+    TEST_ASSERT_EQUAL(1, darray_length(object->relocations));
+    check_entry(object->relocations, 0, "func", 12);
+    object_free(object);
+}
+
+void test_little_endian_layout() {
+    DArray *instructions = darray_init(free);
+    uint32_t *word = malloc(sizeof(uint32_t));
+    *word = 0x8a000000;
+    darray_add(instructions, word);
+
+    ObjectFile *object = object_init();
+    object_add_instructions(object, instructions);
+    object_write(object, object_path);
+    object_free(object);
+    darray_free(instructions);
+
+    // Header of magic, version and counts, then the halt instruction
+    uint8_t expected[] = {0x41, 0x4f, 0x42, 0x4a, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x00, 0x00, 0x00, 0x8a};
+    uint8_t bytes[sizeof(expected) + 1];
+    FILE *object_file = fopen(object_path, "rb");
+    TEST_ASSERT_NOT_NULL(object_file);
+    TEST_ASSERT_EQUAL(sizeof(expected), fread(bytes, 1, sizeof(bytes), object_file));
+    fclose(object_file);
+    TEST_ASSERT_EQUAL(0, memcmp(expected, bytes, sizeof(expected)));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_write_then_read);
+    RUN_TEST(test_little_endian_layout);
+    return UNITY_END();
+}
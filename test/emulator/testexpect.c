@@ -0,0 +1,174 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../Unity/src/unity.h"
+#include "../../src/lib/armv8.h"
+#include "../../src/emulator/expect.h"
+#include "../../src/fault.h"
+
+#define MAX_STATE_SIZE 4096
+
+// Leaves X01 = 5, X02 = 0x100, PC = 0xc, PSTATE -Z-- and 5 stored at 0x100
+static const char *source =
+    "movz x1, #5\n"
+    "movz x2, #0x100\n"
+    "str x1, [x2]\n"
+    "and x0, x0, x0\n";
+
+static char expected_path[] = "/tmp/testexpectXXXXXX";
+static char state[MAX_STATE_SIZE];   // Output of the program, in the format of print_cpu
+
+void setUp(void) {
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(source, strlen(source), &num_instructions);
+    TEST_ASSERT_TRUE(armv8_load(instructions, num_instructions));
+    free(instructions);
+    TEST_ASSERT_TRUE(armv8_run());
+
+    FILE *state_stream = fmemopen(state, MAX_STATE_SIZE, "w");
+    armv8_print_state(state_stream);
+    fclose(state_stream);
+
+    strcpy(expected_path, "/tmp/testexpectXXXXXX");
+    close(mkstemp(expected_path));
+}
+
+void tearDown(void) {
+    remove(expected_path);
+}
+
+/**
+ * @brief Replaces the first occurrence of some text, which must be present, with other text.
+ */
+static void replace(char *text, const char *old, const char *new) {
+    char *found = strstr(text, old);
+    TEST_ASSERT_NOT_NULL(found);
+    memmove(found + strlen(new), found + strlen(old), strlen(found + strlen(old)) + 1);
+    memcpy(found, new, strlen(new));
+}
+
+/**
+ * @brief Writes the program's output to the expected file, with one piece of it replaced.
+ *
+ * @param old Text to replace, which must occur in the output.
+ * @param new Text to replace it with.
+ */
+static void write_expected(const char *old, const char *new) {
+    char expected[MAX_STATE_SIZE];
+    strcpy(expected, state);
+    replace(expected, old, new);
+
+    FILE *expected_file = fopen(expected_path, "w");
+    TEST_ASSERT_NOT_NULL(expected_file);
+    fputs(expected, expected_file);
+    fclose(expected_file);
+}
+
+/**
+ * @brief Loads an expected file that must be rejected, checking the fault's message.
+ */
+static void check_rejected(const char *message) {
+    FaultHandler handler;
+    if (fault_catch(&handler) != 0) {
+        TEST_ASSERT_NOT_NULL(strstr(handler.message, message));
+        return;
+    }
+    expect_load(expected_path);
+    fault_pop(&handler);
+    TEST_FAIL_MESSAGE("expect_load accepted a malformed file");
+}
+
+/**
+ * @brief Checks the CPU against the expected file, returning the number of mismatches and the report.
+ */
+static int check(char *report) {
+    FILE *report_stream = fmemopen(report, MAX_STATE_SIZE, "w");
+    int mismatches = expect_check(report_stream, "prog");
+    fclose(report_stream);
+    return mismatches;
+}
+
+void test_matching_state() {
+    write_expected("Registers:\n", "\nRegisters:\n");
+    expect_load(expected_path);
+
+    char report[MAX_STATE_SIZE] = {0};
+    TEST_ASSERT_EQUAL(0, check(report));
+    TEST_ASSERT_EQUAL_STRING("", report);
+}
+
+void test_mismatch_count() {
+    // A register, the PC, the flags and two memory words differ
+    replace(state, "X02    = 0000000000000100", "X02    = 0000000000000101");
+    replace(state, "PC     = 000000000000000c", "PC     = 0000000000000010");
+    replace(state, "PSTATE : -Z--", "PSTATE : N---");
+    write_expected("0x00000100: 00000005\n", "0x00000100: 00000006\n0x00000200: 00000001\n");
+    expect_load(expected_path);
+
+    char report[MAX_STATE_SIZE] = {0};
+    TEST_ASSERT_EQUAL(5, check(report));
+    TEST_ASSERT_NOT_NULL(strstr(report, "prog: X02: expected 0000000000000101, found 0000000000000100\n"));
+    TEST_ASSERT_NOT_NULL(strstr(report, "prog: PC: expected 0000000000000010, found 000000000000000c\n"));
+    TEST_ASSERT_NOT_NULL(strstr(report, "prog: PSTATE: expected N---, found -Z--\n"));
+    TEST_ASSERT_NOT_NULL(strstr(report, "prog: 0x00000100: expected 00000006, found 00000005\n"));
+    TEST_ASSERT_NOT_NULL(strstr(report, "prog: 0x00000200: expected 00000001, found 00000000\n"));
+}
+
+void test_missing_register() {
+    write_expected("X05    = 0000000000000000\n", "");
+    check_rejected("Missing a register, PC or PSTATE line");
+}
+
+void test_missing_pc() {
+    write_expected("PC     = 000000000000000c\n", "");
+    check_rejected("Missing a register, PC or PSTATE line");
+}
+
+void test_missing_pstate() {
+    write_expected("PSTATE : -Z--\n", "");
+    check_rejected("Missing a register, PC or PSTATE line");
+}
+
+void test_malformed_flags() {
+    write_expected("PSTATE : -Z--\n", "PSTATE : -Z-X\n");
+    check_rejected(":34: Not a line of emulator output");
+    write_expected("PSTATE : -Z--\n", "PSTATE : -Z--V\n");
+    check_rejected(":34: Not a line of emulator output");
+}
+
+void test_unaligned_address() {
+    write_expected("0x00000100: 00000005\n", "0x00000102: 00000005\n");
+    check_rejected("Not a line of emulator output");
+}
+
+void test_address_out_of_range() {
+    write_expected("0x00000100: 00000005\n", "0x00200000: 00000005\n");
+    check_rejected("Not a line of emulator output");
+}
+
+void test_register_out_of_range() {
+    write_expected("X30    = 0000000000000000\n", "X31    = 0000000000000000\n");
+    check_rejected(":32: Not a line of emulator output");
+}
+
+void test_unknown_line() {
+    write_expected("Non-Zero Memory:\n", "Non-Zero Memory:\nhello\n");
+    check_rejected(":36: Not a line of emulator output");
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_matching_state);
+    RUN_TEST(test_mismatch_count);
+    RUN_TEST(test_missing_register);
+    RUN_TEST(test_missing_pc);
+    RUN_TEST(test_missing_pstate);
+    RUN_TEST(test_malformed_flags);
+    RUN_TEST(test_unaligned_address);
+    RUN_TEST(test_address_out_of_range);
+    RUN_TEST(test_register_out_of_range);
+    RUN_TEST(test_unknown_line);
+    return UNITY_END();
+}
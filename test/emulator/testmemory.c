@@ -41,10 +41,58 @@ void test_double_word() {
     TEST_ASSERT_EQUAL_UINT64(0x6543211234567878, get_double_word(0));
 }
 
+static word device_registers[4];
+
+static word device_read(void *state, uint32_t offset) {
+    return ((word *) state)[offset / sizeof(word)];
+}
+
+static void device_write(void *state, uint32_t offset, word data) {
+    ((word *) state)[offset / sizeof(word)] = data;
+}
+
+void test_device() {
+    memory_clear_devices();
+    memory_register_device(0x3f000000, sizeof(device_registers), device_read, device_write, device_registers);
+
+    set_word(0x3f000004, 0xcafe);
+    TEST_ASSERT_EQUAL_UINT32(0xcafe, device_registers[1]);
+    TEST_ASSERT_EQUAL_UINT32(0xcafe, get_word(0x3f000004));
+
+    set_double_word(0x3f000008, 0x8765432112345678);
+    TEST_ASSERT_EQUAL_UINT32(0x12345678, device_registers[2]);
+    TEST_ASSERT_EQUAL_UINT32(0x87654321, device_registers[3]);
+    TEST_ASSERT_EQUAL_UINT64(0x8765432112345678, get_double_word(0x3f000008));
+
+    // RAM is unaffected by the device
+    TEST_ASSERT_EQUAL_UINT32(0, get_word(4));
+    memory_clear_devices();
+}
+
+void test_track_writes() {
+    // A store made before tracking is turned on must still be cleared
+    set_word(0x9000, 0x1234);
+    memory_track_writes(true);
+    init_memory();
+    TEST_ASSERT_EQUAL_UINT32(0, get_word(0x9000));
+
+    // Stores that are tracked, one of them across a page boundary, are cleared by the next reset
+    set_word(0x5000, 0x5678);
+    set_double_word(MEMORY_PAGE_SIZE * 3 - 4, 0x8765432112345678);
+    TEST_ASSERT_EQUAL_UINT32(0x87654321, get_word(MEMORY_PAGE_SIZE * 3));
+    init_memory();
+    TEST_ASSERT_EQUAL_UINT32(0, get_word(0x5000));
+    TEST_ASSERT_EQUAL_UINT64(0, get_double_word(MEMORY_PAGE_SIZE * 3 - 4));
+
+    memory_track_writes(false);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
     RUN_TEST(test_word);
     RUN_TEST(test_double_word);
+    RUN_TEST(test_device);
+    RUN_TEST(test_track_writes);
     return UNITY_END();
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "../Unity/src/unity.h"
 #include "../../src/emulator/register.h"
+#include "../../src/fault.h"
 
 void setUp(void) {
     init_register();
@@ -17,6 +18,13 @@ void test_general_register() {
     TEST_ASSERT_EQUAL_UINT32((uint32_t) value, get_reg_value_32(0));
 }
 
+void test_zero_register() {
+    set_reg_value(NUM_REGISTERS, 0x1234);
+
+    TEST_ASSERT_EQUAL_UINT64(0, get_reg_value_64(NUM_REGISTERS));
+    TEST_ASSERT_EQUAL_UINT32(0, get_reg_value_32(NUM_REGISTERS));
+}
+
 void test_special_register() {
     TEST_ASSERT_EQUAL(0, get_spec_register(ZERO_REGISTER));
     TEST_ASSERT_EQUAL(0, get_spec_register(PROGRAM_COUNTER));
@@ -30,10 +38,22 @@ void test_special_register() {
     TEST_ASSERT_EQUAL(104, get_spec_register(PROGRAM_COUNTER));
 }
 
+void test_register_fault() {
+    FaultHandler handler;
+    if (fault_catch(&handler) == 0) {
+        set_spec_register(STACK_POINTER, 8);
+        fault_pop(&handler);
+        TEST_FAIL_MESSAGE("Writing to the stack pointer did not fault");
+    }
+    TEST_ASSERT_EQUAL_STRING("Error: Cannot write to stack pointer register\n", handler.message);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
     RUN_TEST(test_general_register);
+    RUN_TEST(test_zero_register);
     RUN_TEST(test_special_register);
+    RUN_TEST(test_register_fault);
     return UNITY_END();
 }
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../Unity/src/unity.h"
+#include "../../src/lib/armv8.h"
+
+#define HALT_INSTRUCTION 0x8a000000
+
+static const char *source =
+    "movz x1, #5\n"
+    "movz x2, #0\n"
+    "loop:\n"
+    "add x2, x2, x1\n"
+    "subs x1, x1, #1\n"
+    "b.ne loop\n"
+    "movz x3, #0x100\n"
+    "str x2, [x3]\n"
+    "and x0, x0, x0\n";
+
+void setUp(void) {
+    // set stuff up here
+}
+
+void tearDown(void) {
+    // clean stuff up here
+}
+
+void test_assemble_from_memory() {
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(source, strlen(source), &num_instructions);
+
+    TEST_ASSERT_EQUAL(8, num_instructions);
+    TEST_ASSERT_EQUAL_UINT32(0xd28000a1, instructions[0]);
+    TEST_ASSERT_EQUAL_UINT32(HALT_INSTRUCTION, instructions[7]);
+
+    free(instructions);
+}
+
+void test_run_from_memory() {
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(source, strlen(source), &num_instructions);
+    armv8_load(instructions, num_instructions);
+    free(instructions);
+
+    armv8_run();
+
+    TEST_ASSERT_EQUAL_UINT64(0, armv8_get_register(1));
+    TEST_ASSERT_EQUAL_UINT64(15, armv8_get_register(2));
+    uint32_t word;
+    TEST_ASSERT_TRUE(armv8_get_word(0x100, &word));
+    TEST_ASSERT_EQUAL_UINT32(15, word);
+    TEST_ASSERT_EQUAL_UINT64(7 * 4, armv8_get_pc());
+}
+
+void test_step_until_halt() {
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(source, strlen(source), &num_instructions);
+    armv8_load(instructions, num_instructions);
+    free(instructions);
+
+    int steps = 1;
+    while (armv8_step()) {
+        steps++;
+    }
+
+    // 2 set up + 5 iterations of 3 + 2 stores + halt
+    TEST_ASSERT_EQUAL(20, steps);
+    TEST_ASSERT_EQUAL_UINT64(15, armv8_get_register(2));
+}
+
+void test_assemble_error() {
+    const char *bad_source = "movz x1, #5\nfrobnicate x1, x2\nand x0, x0, x0\n";
+    size_t num_instructions;
+    TEST_ASSERT_NULL(armv8_assemble(bad_source, strlen(bad_source), &num_instructions));
+    TEST_ASSERT_NOT_NULL(strstr(armv8_error(), "frobnicate"));
+
+    // The library is still usable after the error
+    uint32_t *instructions = armv8_assemble(source, strlen(source), &num_instructions);
+    TEST_ASSERT_EQUAL(8, num_instructions);
+    free(instructions);
+}
+
+void test_assemble_comment_lines() {
+    const char *commented_source = "// set up\nmovz x1, #5\n  // indented\n\nand x0, x0, x0 // halt\n//\n";
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(commented_source, strlen(commented_source), &num_instructions);
+    TEST_ASSERT_NOT_NULL(instructions);
+
+    TEST_ASSERT_EQUAL(2, num_instructions);
+    TEST_ASSERT_EQUAL_UINT32(0xd28000a1, instructions[0]);
+    TEST_ASSERT_EQUAL_UINT32(HALT_INSTRUCTION, instructions[1]);
+    free(instructions);
+}
+
+void test_run_fault() {
+    // ldr x1, [x2] with x2 = 0x10000000, beyond the end of memory
+    const char *bad_source = "movz x2, #0x1000, lsl #16\nldr x1, [x2]\nand x0, x0, x0\n";
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(bad_source, strlen(bad_source), &num_instructions);
+    TEST_ASSERT_TRUE(armv8_load(instructions, num_instructions));
+    free(instructions);
+
+    TEST_ASSERT_FALSE(armv8_run());
+    TEST_ASSERT_NOT_NULL(strstr(armv8_error(), "Out of bounds"));
+    TEST_ASSERT_EQUAL_UINT64(4, armv8_get_pc());
+}
+
+void test_get_word_out_of_bounds() {
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(source, strlen(source), &num_instructions);
+    armv8_load(instructions, num_instructions);
+    free(instructions);
+
+    uint32_t word = 0xdeadbeef;
+    TEST_ASSERT_FALSE(armv8_get_word(0x300000, &word));
+    TEST_ASSERT_NOT_NULL(strstr(armv8_error(), "Out of bounds"));
+    TEST_ASSERT_EQUAL_UINT32(0xdeadbeef, word);
+
+    // Memory is still readable after the error
+    TEST_ASSERT_TRUE(armv8_get_word(0, &word));
+    TEST_ASSERT_EQUAL_UINT32(0xd28000a1, word);
+}
+
+void test_fork_variants() {
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(source, strlen(source), &num_instructions);
+    armv8_load(instructions, num_instructions);
+    free(instructions);
+
+    // Warm up to the start of the loop, then sum from a different x1 in each child
+    armv8_step();
+    armv8_step();
+    for (uint64_t x1 = 1; x1 <= 4; x1++) {
+        pid_t child = armv8_fork();
+        TEST_ASSERT_TRUE(child != -1);
+        if (child == 0) {
+            armv8_set_register(1, x1);
+            armv8_run();
+            uint32_t sum;
+            armv8_get_word(0x100, &sum);
+            _exit(sum);
+        }
+        int status;
+        waitpid(child, &status, 0);
+        TEST_ASSERT_TRUE(WIFEXITED(status));
+        TEST_ASSERT_EQUAL(x1 * (x1 + 1) / 2, WEXITSTATUS(status));
+    }
+
+    // The children's runs leave the parent where it was
+    TEST_ASSERT_EQUAL_UINT64(5, armv8_get_register(1));
+    TEST_ASSERT_EQUAL_UINT64(2 * 4, armv8_get_pc());
+    uint32_t word;
+    TEST_ASSERT_TRUE(armv8_get_word(0x100, &word));
+    TEST_ASSERT_EQUAL_UINT32(0, word);
+}
+
+/**
+ * @brief Runs a program from its start, with or without fusion and fast-forwarding, capturing its final state.
+ *
+ * @param program Assembly source of the program.
+ * @param fusion Whether to execute common instruction sequences as one step.
+ * @param fast_forward Whether to skip the iterations of pure counting loops.
+ * @param limit Instruction limit for the run, or UINT64_MAX for none.
+ * @param count Set to the number of instructions executed.
+ * @param state Set to the final state in the format of emulate's output, to be freed by the caller.
+ * @return Whether the program halted.
+ */
+static bool run_capturing(const char *program, bool fusion, bool fast_forward, uint64_t limit, uint64_t *count, char **state) {
+    size_t num_instructions;
+    uint32_t *instructions = armv8_assemble(program, strlen(program), &num_instructions);
+    TEST_ASSERT_NOT_NULL(instructions);
+    TEST_ASSERT_TRUE(armv8_load(instructions, num_instructions));
+    free(instructions);
+
+    armv8_set_fusion(fusion);
+    armv8_set_fast_forward(fast_forward);
+    armv8_set_instruction_limit(limit);
+    bool halted = armv8_run();
+    armv8_set_instruction_limit(UINT64_MAX);
+    armv8_set_fast_forward(false);
+    armv8_set_fusion(true);
+
+    size_t state_size;
+    FILE *state_stream = open_memstream(state, &state_size);
+    armv8_print_state(state_stream);
+    fclose(state_stream);
+    *count = armv8_get_instruction_count();
+    return halted;
+}
+
+/**
+ * @brief Checks that fast-forwarding a program leaves the same state and count as running every
+ *        iteration, and that it skipped the expected number of loops.
+ */
+static void check_fast_forward(const char *program, uint64_t limit, bool halts, uint64_t loops_skipped) {
+    uint64_t plain_count, fast_count, loops, iterations;
+    char *plain_state, *fast_state;
+
+    TEST_ASSERT_EQUAL(halts, run_capturing(program, true, false, limit, &plain_count, &plain_state));
+    TEST_ASSERT_EQUAL(halts, run_capturing(program, true, true, limit, &fast_count, &fast_state));
+    armv8_get_fast_forward_stats(&loops, &iterations);
+
+    TEST_ASSERT_EQUAL_UINT64(plain_count, fast_count);
+    TEST_ASSERT_EQUAL_STRING(plain_state, fast_state);
+    TEST_ASSERT_EQUAL(loops_skipped, loops);
+    TEST_ASSERT_TRUE(loops_skipped == 0 || iterations > 0);
+
+    free(plain_state);
+    free(fast_state);
+}
+
+/**
+ * @brief Checks that a program leaves the same registers, PC, PSTATE, memory and instruction count
+ *        whether or not its common instruction sequences are fused.
+ */
+static void check_fusion(const char *program) {
+    uint64_t plain_count, fused_count;
+    char *plain_state, *fused_state;
+
+    TEST_ASSERT_TRUE(run_capturing(program, false, false, UINT64_MAX, &plain_count, &plain_state));
+    TEST_ASSERT_TRUE(run_capturing(program, true, false, UINT64_MAX, &fused_count, &fused_state));
+
+    TEST_ASSERT_EQUAL_UINT64(plain_count, fused_count);
+    TEST_ASSERT_EQUAL_STRING(plain_state, fused_state);
+
+    free(plain_state);
+    free(fused_state);
+}
+
+void test_fusion_compare_and_branch() {
+    // Each pair leaves its own flags behind, including signed overflow and a branch to the next instruction
+    check_fusion(
+        "movz x1, #5\n"
+        "movz x2, #0x8000, lsl #48\n"
+        "movz x7, #1\n"
+        "loop:\n"
+        "cmp x1, #3\n"
+        "b.gt skip\n"
+        "add x3, x3, #1\n"
+        "skip:\n"
+        "cmp x2, x1\n"
+        "b.lt next\n"
+        "next:\n"
+        "tst x1, x7\n"
+        "b.eq even\n"
+        "add x4, x4, #1\n"
+        "even:\n"
+        "cmn w1, #4\n"
+        "b.eq never\n"
+        "subs x1, x1, #1\n"
+        "b.ne loop\n"
+        "cmp x1, x2\n"
+        "b.ge done\n"
+        "never:\n"
+        "movz x5, #1\n"
+        "done:\n"
+        "ands x6, x4, x3\n"
+        "b.le end\n"
+        "end:\n"
+        "and x0, x0, x0\n");
+}
+
+void test_fusion_counting_loop() {
+    // add, cmp and b.cond groups, stepping up and down, in 64 and 32 bits
+    check_fusion(
+        "movz x1, #0\n"
+        "movz x2, #0x100\n"
+        "up:\n"
+        "add x1, x1, #3\n"
+        "cmp x1, #30\n"
+        "b.lt up\n"
+        "str x1, [x2]\n"
+        "movz w3, #10\n"
+        "down:\n"
+        "sub w3, w3, #1\n"
+        "cmp w3, #0\n"
+        "b.ne down\n"
+        "and x0, x0, x0\n");
+}
+
+void test_fusion_wide_moves() {
+    // movz/movk chains of every length, into 32 and 64-bit registers, followed by flag setting
+    check_fusion(
+        "movz x1, #0x1234, lsl #48\n"
+        "movk x1, #0x5678, lsl #32\n"
+        "movk x1, #0x9abc, lsl #16\n"
+        "movk x1, #0xdef0\n"
+        "movz w2, #0xffff, lsl #16\n"
+        "movk w2, #0x8000\n"
+        "movz x3, #7\n"
+        "movk x3, #1, lsl #16\n"
+        "movz x4, #0x100\n"
+        "str x1, [x4]\n"
+        "cmp w2, w3\n"
+        "and x0, x0, x0\n");
+}
+
+void test_fast_forward_wrapping_counter() {
+    // w0 counts up by 2 from 0xfffffff0, wrapping round to meet 6
+    check_fast_forward(
+        "movz w0, #0xfff0\n"
+        "movk w0, #0xffff, lsl #16\n"
+        "movz w1, #6\n"
+        "loop:\n"
+        "add w0, w0, #2\n"
+        "cmp w0, w1\n"
+        "b.ne loop\n"
+        "and x0, x0, x0\n", UINT64_MAX, true, 1);
+}
+
+void test_fast_forward_even_step() {
+    // Each step of 4 shares a factor of two with the distance of 4000
+    check_fast_forward(
+        "movz x3, #0\n"
+        "loop:\n"
+        "add x3, x3, #4\n"
+        "cmp x3, #4000\n"
+        "b.ne loop\n"
+        "movz x4, #0x100\n"
+        "str x3, [x4]\n"
+        "and x0, x0, x0\n", UINT64_MAX, true, 1);
+}
+
+void test_fast_forward_unreachable_bound() {
+    // x0 stays odd so never equals 10; the loop is left to run until the instruction limit
+    check_fast_forward(
+        "movz x0, #1\n"
+        "loop:\n"
+        "add x0, x0, #2\n"
+        "cmp x0, #10\n"
+        "b.ne loop\n"
+        "and x0, x0, x0\n", 100000, false, 0);
+}
+
+void test_fast_forward_two_instruction_loop() {
+    check_fast_forward(
+        "movz x2, #1000\n"
+        "loop:\n"
+        "subs x2, x2, #1\n"
+        "b.ne loop\n"
+        "and x0, x0, x0\n", UINT64_MAX, true, 1);
+}
+
+void test_fast_forward_stopped_by_limit() {
+    // The limit falls in the middle of the loop, so both runs must stop at the same iteration
+    check_fast_forward(
+        "movz x2, #0x1000, lsl #16\n"
+        "loop:\n"
+        "subs x2, x2, #1\n"
+        "b.ne loop\n"
+        "and x0, x0, x0\n", 12345, false, 1);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_assemble_from_memory);
+    RUN_TEST(test_run_from_memory);
+    RUN_TEST(test_step_until_halt);
+    RUN_TEST(test_assemble_error);
+    RUN_TEST(test_assemble_comment_lines);
+    RUN_TEST(test_run_fault);
+    RUN_TEST(test_get_word_out_of_bounds);
+    RUN_TEST(test_fork_variants);
+    RUN_TEST(test_fusion_compare_and_branch);
+    RUN_TEST(test_fusion_counting_loop);
+    RUN_TEST(test_fusion_wide_moves);
+    RUN_TEST(test_fast_forward_wrapping_counter);
+    RUN_TEST(test_fast_forward_even_step);
+    RUN_TEST(test_fast_forward_unreachable_bound);
+    RUN_TEST(test_fast_forward_two_instruction_loop);
+    RUN_TEST(test_fast_forward_stopped_by_limit);
+    return UNITY_END();
+}